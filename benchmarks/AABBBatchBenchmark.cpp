@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////
+// AABBBatchBenchmark
+///////////////////////////////////////////////////////////////////////////////
+// Times the batch AABB tests of every SIMD level the CPU supports on 4096
+// boxes of 8 to 40 pixels in a 2048x2048 area: each box against all the
+// boxes after it (range candidates, like the brute force broadphase) and
+// against 64 random boxes (indexed candidates, like the other
+// broadphases), next to the per-pair test the CollisionSystem used before.
+// Run with: make benchmark
+///////////////////////////////////////////////////////////////////////////////
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "../src/Physics/AABBBatch.h"
+
+// The per-pair test of the CollisionSystem before the batch tests (position and size)
+static bool CheckAABBCollision(double aX, double aY, double aW, double aH, double bX, double bY, double bW, double bH) {
+    return (
+        aX < bX + bW &&
+        aX + aW > bX &&
+        aY < bY + bH &&
+        aY + aH > bY
+    );
+}
+
+static const char* GetSimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar: return "scalar";
+        case SimdLevel::SSE2: return "SSE2";
+        case SimdLevel::AVX2: return "AVX2";
+        case SimdLevel::AVX512: return "AVX-512";
+    }
+    return "unknown";
+}
+
+// Nanoseconds per pair of running the loop the number of times
+template <typename TLoop>
+static double TimePerPair(double numPairs, int numRuns, TLoop loop) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int run = 0; run < numRuns; run++) {
+        loop();
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / (numPairs * numRuns);
+}
+
+int main() {
+    const int numBoxes = 4096;
+    const int numCandidates = 64;
+    std::mt19937 random(7);
+    std::vector<float> minX(numBoxes), minY(numBoxes), maxX(numBoxes), maxY(numBoxes);
+    std::vector<double> width(numBoxes), height(numBoxes);
+    for (int i = 0; i < numBoxes; i++) {
+        minX[i] = random() % 2048;
+        minY[i] = random() % 2048;
+        width[i] = 8 + random() % 32;
+        height[i] = 8 + random() % 32;
+        maxX[i] = minX[i] + width[i];
+        maxY[i] = minY[i] + height[i];
+    }
+    const BoxArrays boxes = { minX.data(), minY.data(), maxX.data(), maxY.data() };
+    std::vector<int> candidates(numCandidates * numBoxes);
+    for (auto& candidate: candidates) {
+        candidate = random() % numBoxes;
+    }
+    std::vector<int> overlapping(numBoxes);
+    const double numRangePairs = static_cast<double>(numBoxes) * (numBoxes - 1) / 2;
+    const double numIndexedPairs = static_cast<double>(numBoxes) * numCandidates;
+
+    // The results are summed and printed so the compiler keeps the loops
+    long numOverlaps = 0;
+    const double perPairTime = TimePerPair(numRangePairs, 3, [&]() {
+        for (int i = 0; i < numBoxes; i++) {
+            for (int j = i + 1; j < numBoxes; j++) {
+                numOverlaps += CheckAABBCollision(minX[i], minY[i], width[i], height[i], minX[j], minY[j], width[j], height[j]);
+            }
+        }
+    });
+    printf("CheckAABBCollision (double, per pair): %.2f ns/pair (%ld overlaps)\n", perPairTime, numOverlaps / 3);
+
+    for (int level = 0; level <= static_cast<int>(AABBBatch::GetSupportedSimdLevel()); level++) {
+        AABBBatch::SetSimdLevel(static_cast<SimdLevel>(level));
+        long numRangeOverlaps = 0;
+        const double rangeTime = TimePerPair(numRangePairs, 3, [&]() {
+            for (int i = 0; i < numBoxes; i++) {
+                numRangeOverlaps += AABBBatch::OverlapsRange(boxes, i, i + 1, numBoxes - i - 1, overlapping.data());
+            }
+        });
+        long numIndexedOverlaps = 0;
+        const double indexedTime = TimePerPair(numIndexedPairs, 30, [&]() {
+            for (int i = 0; i < numBoxes; i++) {
+                numIndexedOverlaps += AABBBatch::Overlaps(boxes, i, candidates.data() + numCandidates * i, numCandidates, overlapping.data());
+            }
+        });
+        printf("%-8s range %.2f ns/pair, indexed %.2f ns/pair (%ld and %ld overlaps)\n",
+            GetSimdLevelName(static_cast<SimdLevel>(level)), rangeTime, indexedTime, numRangeOverlaps / 3, numIndexedOverlaps / 30);
+    }
+    return 0;
+}
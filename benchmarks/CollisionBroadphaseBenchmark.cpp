@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+// CollisionBroadphaseBenchmark
+///////////////////////////////////////////////////////////////////////////////
+// Times a CollisionSystem update with each broadphase on 1k, 10k and 100k
+// moving colliders of 1 to 32 pixels, scattered at the same density (the
+// world grows with the number of colliders). The brute force broadphase
+// takes tens of seconds at 100k colliders, so it only runs there when the
+// program is given --all.
+// Run with: make benchmark
+///////////////////////////////////////////////////////////////////////////////
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include "../src/ECS/ECS.h"
+#include "../src/EventBus/EventBus.h"
+#include "../src/Systems/CollisionSystem.h"
+
+// Milliseconds of a collision update with the broadphase, after a first update that builds the broadphase structures
+static double TimeUpdate(std::unique_ptr<Registry>& registry, Broadphase broadphase) {
+    auto eventBus = std::make_unique<EventBus>();
+    CollisionSystem& collisionSystem = registry->GetSystem<CollisionSystem>();
+    collisionSystem.SetBroadphase(broadphase);
+    collisionSystem.Update(registry, eventBus);
+    const auto start = std::chrono::steady_clock::now();
+    collisionSystem.Update(registry, eventBus);
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    const bool shouldRunAll = argc > 1 && strcmp(argv[1], "--all") == 0;
+    for (int numColliders: { 1000, 10000, 100000 }) {
+        auto registry = std::make_unique<Registry>();
+        registry->AddSystem<CollisionSystem>();
+        registry->GetSystem<CollisionSystem>().SetCellSize(64.0);
+        const double worldSize = std::sqrt(static_cast<double>(numColliders)) * 64.0;
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> position(0.0f, worldSize);
+        for (int i = 0; i < numColliders; i++) {
+            Entity entity = registry->CreateEntity();
+            entity.AddComponent<TransformComponent>(glm::vec2(position(random), position(random)), glm::vec2(1.0, 1.0), 0.0);
+            entity.AddComponent<RigidBodyComponent>();
+            entity.AddComponent<BoxColliderComponent>(glm::vec2(0), 1 + random() % 32, 1 + random() % 32);
+        }
+        registry->Update();
+
+        printf("%6d colliders:", numColliders);
+        if (numColliders <= 10000 || shouldRunAll) {
+            printf(" brute force %.2f ms,", TimeUpdate(registry, Broadphase::BruteForce));
+        } else {
+            printf(" brute force skipped (--all),");
+        }
+        printf(" spatial hash %.2f ms,", TimeUpdate(registry, Broadphase::SpatialHash));
+        printf(" sweep and prune %.2f ms,", TimeUpdate(registry, Broadphase::SweepAndPrune));
+        printf(" AABB tree %.2f ms", TimeUpdate(registry, Broadphase::AABBTree));
+        printf(" (%d contacts)\n", registry->GetSystem<CollisionSystem>().GetContactCounters().numContacts);
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// CollisionQueryBenchmark
+///////////////////////////////////////////////////////////////////////////////
+// Times the spatial queries of the CollisionSystem on the AABB trees and
+// scanning every collider (spatial hash broadphase), on 100k colliders
+// (half static, 7 layers) in a 20000x20000 world. The scan is slow, so it
+// runs 500 queries and the trees 20000.
+// Run with: make benchmark
+///////////////////////////////////////////////////////////////////////////////
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+#include "../src/ECS/ECS.h"
+#include "../src/EventBus/EventBus.h"
+#include "../src/Systems/CollisionSystem.h"
+
+const int NUM_COLLIDERS = 100000;
+const int WORLD_SIZE = 20000;
+
+// A random world, with the colliders gathered by an update with the broadphase
+static std::unique_ptr<Registry> MakeWorld(Broadphase broadphase) {
+    std::mt19937 random(3);
+    auto registry = std::make_unique<Registry>();
+    registry->AddSystem<CollisionSystem>();
+    for (int i = 0; i < NUM_COLLIDERS; i++) {
+        Entity entity = registry->CreateEntity();
+        entity.AddComponent<TransformComponent>(glm::vec2(random() % WORLD_SIZE, random() % WORLD_SIZE), glm::vec2(1.0, 1.0), 0.0);
+        const int width = random() % 40 + 1;
+        const int height = random() % 40 + 1;
+        entity.AddComponent<BoxColliderComponent>(glm::vec2(0), width, height, static_cast<CollisionLayer>(random() % 7));
+        if (i % 2) {
+            entity.AddComponent<RigidBodyComponent>();
+        }
+    }
+    registry->Update();
+    auto eventBus = std::make_unique<EventBus>();
+    CollisionSystem& collisionSystem = registry->GetSystem<CollisionSystem>();
+    collisionSystem.SetBroadphase(broadphase);
+    collisionSystem.SetCellSize(64.0);
+    collisionSystem.Update(registry, eventBus);
+    return registry;
+}
+
+int main() {
+    auto treeRegistry = MakeWorld(Broadphase::AABBTree);
+    auto scanRegistry = MakeWorld(Broadphase::SpatialHash);
+    const CollisionSystem& trees = treeRegistry->GetSystem<CollisionSystem>();
+    const CollisionSystem& scan = scanRegistry->GetSystem<CollisionSystem>();
+
+    // Query positions and ray directions
+    std::mt19937 random(5);
+    std::vector<std::array<double, 4>> queries(20000);
+    for (auto& query: queries) {
+        query = { double(random() % WORLD_SIZE), double(random() % WORLD_SIZE), double(int(random() % 1000) - 500), double(int(random() % 1000) - 500) };
+    }
+    const uint32_t allLayers = ~uint32_t(0);
+    const uint32_t twoLayers = CollisionMatrix::GetLayerBit(CollisionLayer::Player) | CollisionMatrix::GetLayerBit(CollisionLayer::Enemy);
+    std::vector<Entity> entities(256, Entity(-1));
+    std::vector<double> distances(8);
+
+    // Prints the microseconds per query and the mean number of results of the query on the trees and on the scan
+    auto benchmark = [&](const char* name, auto query) {
+        double times[2];
+        double results[2];
+        const CollisionSystem* systems[2] = { &trees, &scan };
+        for (int i = 0; i < 2; i++) {
+            const int numQueries = i == 0 ? queries.size() : 500;
+            long numResults = 0;
+            const auto start = std::chrono::steady_clock::now();
+            for (int j = 0; j < numQueries; j++) {
+                numResults += query(*systems[i], queries[j]);
+            }
+            const auto end = std::chrono::steady_clock::now();
+            times[i] = std::chrono::duration<double, std::micro>(end - start).count() / numQueries;
+            results[i] = static_cast<double>(numResults) / numQueries;
+        }
+        printf("%-28s trees %7.2f us, scan %8.2f us (%.1f results)\n", name, times[0], times[1], results[0]);
+    };
+    benchmark("OverlapBox 128x128", [&](const CollisionSystem& system, const std::array<double, 4>& query) {
+        return system.OverlapBox({ query[0], query[1], query[0] + 128, query[1] + 128 }, allLayers, entities.data(), entities.size());
+    });
+    benchmark("OverlapCircle r=200", [&](const CollisionSystem& system, const std::array<double, 4>& query) {
+        return system.OverlapCircle(query[0], query[1], 200, allLayers, entities.data(), entities.size());
+    });
+    benchmark("OverlapCircle r=200 2 layers", [&](const CollisionSystem& system, const std::array<double, 4>& query) {
+        return system.OverlapCircle(query[0], query[1], 200, twoLayers, entities.data(), entities.size());
+    });
+    benchmark("Raycast 700 px", [&](const CollisionSystem& system, const std::array<double, 4>& query) {
+        RaycastHit hit;
+        Entity entity(-1);
+        return static_cast<int>(system.Raycast(query[0], query[1], query[0] + query[2], query[1] + query[3], allLayers, hit, entity));
+    });
+    benchmark("NearestK k=8", [&](const CollisionSystem& system, const std::array<double, 4>& query) {
+        return system.NearestK(query[0], query[1], 8, allLayers, entities.data(), distances.data());
+    });
+    benchmark("NearestK k=8 2 layers", [&](const CollisionSystem& system, const std::array<double, 4>& query) {
+        return system.NearestK(query[0], query[1], 8, twoLayers, entities.data(), distances.data());
+    });
+    return 0;
+}
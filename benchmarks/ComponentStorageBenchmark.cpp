@@ -0,0 +1,110 @@
+///////////////////////////////////////////////////////////////////////////////
+// ComponentStorageBenchmark
+///////////////////////////////////////////////////////////////////////////////
+// Measures the component storage the engine is built with on a world like
+// the game's: 200k entities, 180k tile-like (Transform + Sprite) and 20k
+// unit-like (also Health, RigidBody and BoxCollider). Reports the memory
+// allocated for the world, the iteration time of a common and of a rare
+// combination of components, and the time of removing and adding back a
+// component (which moves the entity between archetypes).
+// Run with: make benchmark (sparse-set pools), and with archetypes:
+// make benchmark BENCHMARK_FLAGS="-O2 -DLOG_MIN_LEVEL=2 -DECS_ARCHETYPE_STORAGE"
+///////////////////////////////////////////////////////////////////////////////
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include "../src/ECS/ECS.h"
+#include "../src/Components/TransformComponent.h"
+#include "../src/Components/SpriteComponent.h"
+#include "../src/Components/RigidBodyComponent.h"
+#include "../src/Components/BoxColliderComponent.h"
+#include "../src/Components/HealthComponent.h"
+
+// Bytes allocated and not freed yet, counted by the global operator new (each block keeps its size in front of it)
+static size_t allocatedBytes = 0;
+static constexpr size_t BLOCK_HEADER_SIZE = alignof(std::max_align_t);
+
+void* operator new(size_t size) {
+    char* block = static_cast<char*>(std::malloc(size + BLOCK_HEADER_SIZE));
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast<size_t*>(block) = size;
+    allocatedBytes += size;
+    return block + BLOCK_HEADER_SIZE;
+}
+
+void operator delete(void* pointer) noexcept {
+    if (!pointer) {
+        return;
+    }
+    char* block = static_cast<char*>(pointer) - BLOCK_HEADER_SIZE;
+    allocatedBytes -= *reinterpret_cast<size_t*>(block);
+    std::free(block);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    operator delete(pointer);
+}
+
+// Nanoseconds per operation of running the loop the number of times
+template <typename TLoop>
+static double TimePerOperation(double numOperations, int numRuns, TLoop loop) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int run = 0; run < numRuns; run++) {
+        loop();
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / (numOperations * numRuns);
+}
+
+int main() {
+#ifdef ECS_ARCHETYPE_STORAGE
+    const char* storageName = "archetypes";
+#else
+    const char* storageName = "pools";
+#endif
+    const int numEntities = 200000;
+    const float deltaTime = 0.016f;
+
+    std::vector<Entity> units;
+    units.reserve(numEntities / 10);
+    const size_t bytesBefore = allocatedBytes;
+    Registry registry;
+    for (int i = 0; i < numEntities; i++) {
+        Entity entity = registry.CreateEntity();
+        entity.AddComponent<TransformComponent>(glm::vec2(i, i), glm::vec2(1.0, 1.0), 0.0);
+        entity.AddComponent<SpriteComponent>(TextureHandle(), 32, 32, 0);
+        if (i % 10 == 0) {
+            entity.AddComponent<HealthComponent>(100);
+            entity.AddComponent<RigidBodyComponent>(glm::vec2(3.0, 0.0));
+            entity.AddComponent<BoxColliderComponent>(glm::vec2(0, 10), 25, 15);
+            units.push_back(entity);
+        }
+    }
+    registry.Update();
+    const size_t worldBytes = allocatedBytes - bytesBefore;
+
+    const double rareTime = TimePerOperation(units.size(), 20, [&]() {
+        for (auto [entity, transform, rigidBody]: registry.View<TransformComponent, RigidBodyComponent>()) {
+            transform.position += rigidBody.velocity * deltaTime;
+        }
+    });
+    const double commonTime = TimePerOperation(numEntities, 20, [&]() {
+        for (auto [entity, transform, sprite]: registry.View<TransformComponent, SpriteComponent>()) {
+            transform.position.y += sprite.zIndex;
+        }
+    });
+    const double churnTime = TimePerOperation(2.0 * units.size(), 5, [&]() {
+        for (auto entity: units) {
+            entity.RemoveComponent<RigidBodyComponent>();
+            entity.AddComponent<RigidBodyComponent>(glm::vec2(1.0, 0.0));
+        }
+    });
+
+    printf("%s: %.1f MB, Transform+RigidBody %.1f ns/entity, Transform+Sprite %.1f ns/entity, remove+add RigidBody %.1f ns/operation\n",
+        storageName, worldBytes / 1e6, rareTime, commonTime, churnTime);
+    return 0;
+}
@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+// ComponentViewBenchmark
+///////////////////////////////////////////////////////////////////////////////
+// Times a movement loop (position += velocity * dt) over 10k, 100k and 1M
+// entities, the way systems iterated before component views (copying the
+// system entity list and looking up each component through a shared_ptr
+// pool cast, as Registry::GetComponent did) and with Registry::View.
+// Run with: make benchmark
+///////////////////////////////////////////////////////////////////////////////
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "../src/ECS/ECS.h"
+#include "../src/Components/TransformComponent.h"
+#include "../src/Components/RigidBodyComponent.h"
+
+class MovingSystem: public System {
+    public:
+        MovingSystem() {
+            RequireComponent<TransformComponent>();
+            RequireComponent<RigidBodyComponent>();
+        }
+};
+
+// Nanoseconds per entity of running the loop the number of times
+template <typename TLoop>
+static double TimePerEntity(int numEntities, int numRuns, TLoop loop) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int run = 0; run < numRuns; run++) {
+        loop();
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / (static_cast<double>(numEntities) * numRuns);
+}
+
+int main() {
+    const int numRuns = 10;
+    const float deltaTime = 0.016f;
+    for (int numEntities: { 10000, 100000, 1000000 }) {
+        Registry registry;
+        registry.AddSystem<MovingSystem>();
+        for (int i = 0; i < numEntities; i++) {
+            Entity entity = registry.CreateEntity();
+            entity.AddComponent<TransformComponent>();
+            entity.AddComponent<RigidBodyComponent>(glm::vec2(1.0, 2.0));
+        }
+        registry.Update();
+        const MovingSystem& system = registry.GetSystem<MovingSystem>();
+
+        // The shared_ptr pools the registry used to hand out on every component lookup
+        std::shared_ptr<IPool> transformPool = std::make_shared<Pool<TransformComponent>>();
+        std::shared_ptr<IPool> rigidBodyPool = std::make_shared<Pool<RigidBodyComponent>>();
+
+        const double copyTime = TimePerEntity(numEntities, numRuns, [&]() {
+            const std::vector<Entity> entities = system.GetSystemEntities();
+            for (auto entity: entities) {
+                const auto transformPoolCopy = std::static_pointer_cast<Pool<TransformComponent>>(transformPool);
+                const auto rigidBodyPoolCopy = std::static_pointer_cast<Pool<RigidBodyComponent>>(rigidBodyPool);
+                TransformComponent& transform = entity.GetComponent<TransformComponent>();
+                const RigidBodyComponent& rigidBody = entity.GetComponent<RigidBodyComponent>();
+                transform.position += rigidBody.velocity * deltaTime;
+            }
+        });
+        const double viewTime = TimePerEntity(numEntities, numRuns, [&]() {
+            for (auto [entity, transform, rigidBody]: registry.View<TransformComponent, RigidBodyComponent>()) {
+                transform.position += rigidBody.velocity * deltaTime;
+            }
+        });
+        printf("%7d entities: copy and look up %.1f ns/entity, view %.1f ns/entity\n", numEntities, copyTime, viewTime);
+    }
+    return 0;
+}
@@ -0,0 +1,137 @@
+///////////////////////////////////////////////////////////////////////////////
+// SpriteCullingBenchmark
+///////////////////////////////////////////////////////////////////////////////
+// Renders 200k trees and 20k moving tanks scattered over a tile world
+// (32 px tiles) through an 800x600 camera scrolling across the map for 600
+// frames, in a 4096x4096 tile world (131072 px across, a few thousandths of
+// a percent of the sprites in view) and a 216x216 tile one (6912 px across,
+// about 1% in view). Tiles are drawn by the TileLayer and sprites by the
+// RenderSystem, into a software renderer, so no window is needed. Reports
+// the time per frame of each, the visible and culled sprites, and the tile
+// chunks drawn and baked.
+// Run with: make benchmark (from the root of the repository, for the assets)
+///////////////////////////////////////////////////////////////////////////////
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "../src/ECS/ECS.h"
+#include "../src/AssetStore/AssetStore.h"
+#include "../src/Render/TileLayer.h"
+#include "../src/Systems/RenderSystem.h"
+
+const int TILE_SIZE = 32;
+const int NUM_TREES = 200000;
+const int NUM_TANKS = 20000;
+const int NUM_FRAMES = 600;
+
+static double GetMilliseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+static void RunScene(SDL_Renderer* renderer, std::unique_ptr<AssetStore>& assetStore, int mapSize) {
+    const auto setupStart = std::chrono::steady_clock::now();
+    std::mt19937 random(1);
+    TileLayer tileLayer;
+    tileLayer.Resize(mapSize, mapSize, TILE_SIZE, 1.0, assetStore->GetTextureHandle("tilemap-texture"));
+    for (int row = 0; row < mapSize; row++) {
+        for (int col = 0; col < mapSize; col++) {
+            tileLayer.SetTile(col, row, random() % 10 * TILE_SIZE, random() % 3 * TILE_SIZE);
+        }
+    }
+
+    auto registry = std::make_unique<Registry>();
+    registry->AddSystem<RenderSystem>();
+    const int worldSize = mapSize * TILE_SIZE;
+    const TextureHandle treeTexture = assetStore->GetTextureHandle("tree-texture");
+    const TextureHandle tankTexture = assetStore->GetTextureHandle("tank-texture");
+    for (int i = 0; i < NUM_TREES; i++) {
+        Entity tree = registry->CreateEntity();
+        tree.AddComponent<TransformComponent>(glm::vec2(random() % worldSize, random() % worldSize), glm::vec2(1.0, 1.0), 0.0);
+        tree.AddComponent<SpriteComponent>(treeTexture, 16, 32, 1);
+    }
+    std::vector<Entity> tanks;
+    for (int i = 0; i < NUM_TANKS; i++) {
+        Entity tank = registry->CreateEntity();
+        const glm::vec2 velocity(static_cast<int>(random() % 200) - 100, static_cast<int>(random() % 200) - 100);
+        tank.AddComponent<TransformComponent>(glm::vec2(random() % worldSize, random() % worldSize), glm::vec2(1.0, 1.0), 0.0);
+        tank.AddComponent<RigidBodyComponent>(velocity);
+        tank.AddComponent<SpriteComponent>(tankTexture, 32, 32, 2);
+        tanks.push_back(tank);
+    }
+    registry->Update();
+    const auto setupEnd = std::chrono::steady_clock::now();
+
+    RenderSystem& renderSystem = registry->GetSystem<RenderSystem>();
+    SDL_Rect camera = { 0, 0, 800, 600 };
+    const double deltaTime = 1.0 / 60;
+    double tilesTime = 0.0;
+    double spritesTime = 0.0;
+    long numVisible = 0;
+    long numCulled = 0;
+    long numWithoutTexture = 0;
+    long numVisibleChunks = 0;
+    long numBakedChunks = 0;
+    for (int frame = 0; frame < NUM_FRAMES; frame++) {
+        // Move the tanks like the MovementSystem, and scroll the camera right and down
+        for (auto tank: tanks) {
+            auto& transform = tank.GetComponent<TransformComponent>();
+            transform.position += tank.GetComponent<RigidBodyComponent>().velocity * static_cast<float>(deltaTime);
+            transform.version++;
+        }
+        camera.x = frame * 8;
+        camera.y = frame * 4;
+
+        SDL_SetRenderDrawColor(renderer, 21, 21, 21, 255);
+        SDL_RenderClear(renderer);
+        const auto start = std::chrono::steady_clock::now();
+        tileLayer.Render(renderer, assetStore, camera);
+        const auto tilesEnd = std::chrono::steady_clock::now();
+        renderSystem.Update(registry, renderer, assetStore, camera);
+        const auto spritesEnd = std::chrono::steady_clock::now();
+
+        tilesTime += GetMilliseconds(start, tilesEnd);
+        spritesTime += GetMilliseconds(tilesEnd, spritesEnd);
+        numVisible += renderSystem.GetCullingCounters().numVisible;
+        numCulled += renderSystem.GetCullingCounters().numCulled;
+        numWithoutTexture += renderSystem.GetCullingCounters().numWithoutTexture;
+        numVisibleChunks += tileLayer.GetCounters().numVisibleChunks;
+        numBakedChunks += tileLayer.GetCounters().numBakedChunks;
+    }
+
+    printf("%dx%d tiles, %d sprites (setup %.0f ms):\n", mapSize, mapSize, NUM_TREES + NUM_TANKS, GetMilliseconds(setupStart, setupEnd));
+    printf("  tiles   %.3f ms/frame, %.1f chunks drawn per frame, %ld baked in %d frames\n",
+        tilesTime / NUM_FRAMES, static_cast<double>(numVisibleChunks) / NUM_FRAMES, numBakedChunks, NUM_FRAMES);
+    printf("  sprites %.3f ms/frame, %.1f visible per frame (%.3f%%), %.0f culled, %.0f without texture\n",
+        spritesTime / NUM_FRAMES, static_cast<double>(numVisible) / NUM_FRAMES, 100.0 * numVisible / (numVisible + numCulled + numWithoutTexture),
+        static_cast<double>(numCulled) / NUM_FRAMES, static_cast<double>(numWithoutTexture) / NUM_FRAMES);
+
+    tileLayer.ClearChunks();
+}
+
+int main() {
+    SDL_Surface* screen = SDL_CreateRGBSurfaceWithFormat(0, 800, 600, 32, SDL_PIXELFORMAT_RGBA8888);
+    SDL_Renderer* renderer = screen ? SDL_CreateSoftwareRenderer(screen) : nullptr;
+    if (!renderer) {
+        printf("Error creating the software renderer: %s\n", SDL_GetError());
+        return 1;
+    }
+    auto assetStore = std::make_unique<AssetStore>();
+    assetStore->AddTextureAtlas(renderer, {
+        { "tank-texture", "./assets/images/tank-big-right.png" },
+        { "tree-texture", "./assets/images/tree-small-1.png" },
+        { "tilemap-texture", "./assets/tilemaps/jungle.png" }
+    });
+
+    // Sparse: the camera sees a few thousandths of a percent of the world
+    RunScene(renderer, assetStore, 4096);
+    // Dense: the camera sees about 1% of the world
+    RunScene(renderer, assetStore, 216);
+
+    assetStore->ClearAssets();
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(screen);
+    return 0;
+}
@@ -0,0 +1,441 @@
+#ifndef ARCHETYPE_H
+#define ARCHETYPE_H
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <array>
+#include <new>
+#include <cstddef>
+#include <algorithm>
+
+// Size in bytes of each chunk of entities of an archetype
+const unsigned int ARCHETYPE_CHUNK_SIZE = 16 * 1024;
+
+///////////////////////////////////////////////////////////////////////////////
+// ComponentInfo
+///////////////////////////////////////////////////////////////////////////////
+// Type-erased description of a component type, so chunk columns can be moved
+// and destroyed without knowing the component type at compile time.
+///////////////////////////////////////////////////////////////////////////////
+struct ComponentInfo {
+    size_t size;
+    size_t alignment;
+    void (*moveConstruct)(void* destination, void* source);
+    void (*destroy)(void* object);
+
+    template <typename T>
+    static ComponentInfo Create() {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "Component alignment is bigger than the chunk alignment");
+        ComponentInfo info;
+        info.size = sizeof(T);
+        info.alignment = alignof(T);
+        info.moveConstruct = [](void* destination, void* source) {
+            new (destination) T(std::move(*static_cast<T*>(source)));
+        };
+        info.destroy = [](void* object) {
+            static_cast<T*>(object)->~T();
+        };
+        return info;
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Archetype
+///////////////////////////////////////////////////////////////////////////////
+// An archetype holds all entities that have exactly the same set of component
+// types. Entities are stored in fixed-size chunks, and each chunk keeps one
+// packed column per component type (SoA) plus a column with the entity ids.
+// All chunks are full except the last one, so the position of an entity in the
+// archetype is simply a row number (chunk = row / capacity).
+///////////////////////////////////////////////////////////////////////////////
+class Archetype {
+    public:
+        // Sorted component ids of this archetype and the info of each column (same index)
+        std::vector<int> componentIds;
+        std::vector<ComponentInfo> columnInfos;
+
+        // Column of each component id (vector index = component id, -1 = not part of the archetype)
+        std::vector<int> columnIndices;
+
+        // Byte offset of each column (and of the entity ids) inside a chunk
+        std::vector<size_t> columnOffsets;
+        size_t entityIdsOffset = 0;
+
+        int chunkCapacity = 0;
+        int numEntities = 0;
+        std::vector<std::unique_ptr<unsigned char[]>> chunks;
+
+        // Archetypes reached by adding/removing a component id (vector index = component id), cached to make changes cheap
+        std::vector<Archetype*> addEdges;
+        std::vector<Archetype*> removeEdges;
+
+        Archetype(const std::vector<int>& componentIds, const std::vector<ComponentInfo>& columnInfos)
+            : componentIds(componentIds), columnInfos(columnInfos) {
+            for (unsigned int column = 0; column < componentIds.size(); column++) {
+                if (componentIds[column] >= static_cast<int>(columnIndices.size())) {
+                    columnIndices.resize(componentIds[column] + 1, -1);
+                }
+                columnIndices[componentIds[column]] = column;
+            }
+
+            // Find how many rows fit in a chunk, leaving room to align each column
+            size_t rowSize = sizeof(int);
+            size_t alignmentSlack = 0;
+            for (auto& info: columnInfos) {
+                rowSize += info.size;
+                alignmentSlack += info.alignment;
+            }
+            chunkCapacity = std::max<int>(1, (ARCHETYPE_CHUNK_SIZE - alignmentSlack) / rowSize);
+
+            size_t offset = 0;
+            entityIdsOffset = offset;
+            offset += sizeof(int) * chunkCapacity;
+            for (auto& info: columnInfos) {
+                offset = (offset + info.alignment - 1) / info.alignment * info.alignment;
+                columnOffsets.push_back(offset);
+                offset += info.size * chunkCapacity;
+            }
+        }
+
+        ~Archetype() {
+            for (int row = 0; row < numEntities; row++) {
+                for (unsigned int column = 0; column < columnInfos.size(); column++) {
+                    columnInfos[column].destroy(GetComponent(column, row));
+                }
+            }
+        }
+
+        bool HasComponent(int componentId) const {
+            return componentId < static_cast<int>(columnIndices.size()) && columnIndices[componentId] != -1;
+        }
+
+        int GetColumn(int componentId) const {
+            return columnIndices[componentId];
+        }
+
+        unsigned char* GetColumnData(int column, int chunk) const {
+            return chunks[chunk].get() + columnOffsets[column];
+        }
+
+        int* GetEntityIds(int chunk) const {
+            return reinterpret_cast<int*>(chunks[chunk].get() + entityIdsOffset);
+        }
+
+        void* GetComponent(int column, int row) const {
+            return GetColumnData(column, row / chunkCapacity) + columnInfos[column].size * (row % chunkCapacity);
+        }
+
+        int& GetEntityId(int row) const {
+            return GetEntityIds(row / chunkCapacity)[row % chunkCapacity];
+        }
+
+        // Reserves a new row at the end of the archetype (the caller constructs the components)
+        int AllocateRow(int entityId) {
+            if (numEntities == static_cast<int>(chunks.size()) * chunkCapacity) {
+                chunks.push_back(std::unique_ptr<unsigned char[]>(new unsigned char[ARCHETYPE_CHUNK_SIZE]));
+            }
+            const int row = numEntities++;
+            GetEntityId(row) = entityId;
+            return row;
+        }
+
+        // Destroys the components in the row and moves the last row into it. Returns the id of the moved entity (or -1).
+        int RemoveRow(int row) {
+            const int lastRow = numEntities - 1;
+            int movedEntityId = -1;
+            for (unsigned int column = 0; column < columnInfos.size(); column++) {
+                columnInfos[column].destroy(GetComponent(column, row));
+                if (row != lastRow) {
+                    columnInfos[column].moveConstruct(GetComponent(column, row), GetComponent(column, lastRow));
+                    columnInfos[column].destroy(GetComponent(column, lastRow));
+                }
+            }
+            if (row != lastRow) {
+                movedEntityId = GetEntityId(lastRow);
+                GetEntityId(row) = movedEntityId;
+            }
+            numEntities--;
+
+            // Keep one spare chunk around so entities going back and forth don't reallocate
+            const int numChunksNeeded = (numEntities + chunkCapacity - 1) / chunkCapacity;
+            if (static_cast<int>(chunks.size()) > numChunksNeeded + 1) {
+                chunks.pop_back();
+            }
+            return movedEntityId;
+        }
+};
+
+// Position of the type T in a list of types, known at compile time
+template <typename T, typename ...TOthers>
+struct TypeIndex;
+
+template <typename T, typename ...TOthers>
+struct TypeIndex<T, T, TOthers...> {
+    static constexpr size_t value = 0;
+};
+
+template <typename T, typename TFirst, typename ...TOthers>
+struct TypeIndex<T, TFirst, TOthers...> {
+    static constexpr size_t value = 1 + TypeIndex<T, TOthers...>::value;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ArchetypeView
+///////////////////////////////////////////////////////////////////////////////
+// Iterates the entities of all archetypes that contain the given components,
+// walking each chunk column by column.
+///////////////////////////////////////////////////////////////////////////////
+template <typename ...TComponents>
+class ArchetypeView {
+    private:
+        std::vector<Archetype*> archetypes;
+        std::array<int, sizeof...(TComponents)> componentIds;
+
+        // Position of the first row of each matching archetype, as if all of them were a single list
+        std::vector<size_t> firstPositions;
+        size_t size = 0;
+
+    public:
+        ArchetypeView(const std::vector<Archetype*>& allArchetypes, std::array<int, sizeof...(TComponents)> componentIds): componentIds(componentIds) {
+            for (auto archetype: allArchetypes) {
+                bool isMatch = archetype->numEntities > 0;
+                for (auto componentId: componentIds) {
+                    isMatch = isMatch && archetype->HasComponent(componentId);
+                }
+                if (isMatch) {
+                    archetypes.push_back(archetype);
+                    firstPositions.push_back(size);
+                    size += archetype->numEntities;
+                }
+            }
+        }
+
+        class Iterator {
+            private:
+                const ArchetypeView* view;
+                size_t archetypeIndex;
+                int row;
+
+                // Row inside the current chunk and the base of each column of the current chunk
+                int chunkRow = 0;
+                int chunkSize = 0;
+                int* entityIds = nullptr;
+                std::array<unsigned char*, sizeof...(TComponents)> columns;
+
+                void LoadChunk() {
+                    if (archetypeIndex >= view->archetypes.size()) {
+                        return;
+                    }
+                    const Archetype* archetype = view->archetypes[archetypeIndex];
+                    const int chunk = row / archetype->chunkCapacity;
+                    const int chunkStart = chunk * archetype->chunkCapacity;
+                    chunkRow = 0;
+                    chunkSize = std::min(archetype->chunkCapacity, archetype->numEntities - chunkStart);
+                    entityIds = archetype->GetEntityIds(chunk);
+                    for (size_t i = 0; i < columns.size(); i++) {
+                        columns[i] = archetype->GetColumnData(archetype->GetColumn(view->componentIds[i]), chunk);
+                    }
+                }
+
+            public:
+                Iterator(const ArchetypeView* view, size_t archetypeIndex, int row = 0): view(view), archetypeIndex(archetypeIndex), row(row) {
+                    LoadChunk();
+                    chunkRow = row % (archetypeIndex < view->archetypes.size() ? view->archetypes[archetypeIndex]->chunkCapacity : 1);
+                }
+
+                int GetEntityId() const {
+                    return entityIds[chunkRow];
+                }
+
+                size_t GetPosition() const {
+                    return archetypeIndex < view->archetypes.size() ? view->firstPositions[archetypeIndex] + row : view->size;
+                }
+
+                template <typename T>
+                T& Get() const {
+                    return reinterpret_cast<T*>(columns[TypeIndex<T, TComponents...>::value])[chunkRow];
+                }
+
+                Iterator& operator ++() {
+                    row++;
+                    chunkRow++;
+                    if (chunkRow == chunkSize) {
+                        if (row == view->archetypes[archetypeIndex]->numEntities) {
+                            archetypeIndex++;
+                            row = 0;
+                        }
+                        LoadChunk();
+                    }
+                    return *this;
+                }
+
+                bool operator ==(const Iterator& other) const { return archetypeIndex == other.archetypeIndex && row == other.row; }
+                bool operator !=(const Iterator& other) const { return !(*this == other); }
+        };
+
+        Iterator begin() const { return Iterator(this, 0); }
+        Iterator end() const { return Iterator(this, archetypes.size()); }
+
+        // Random access to split the iteration in chunks (positions go from 0 to GetSize())
+        size_t GetSize() const { return size; }
+        Iterator At(size_t position) const {
+            const size_t archetypeIndex = std::upper_bound(firstPositions.begin(), firstPositions.end(), position) - firstPositions.begin();
+            if (archetypeIndex == 0 || position >= size) {
+                return end();
+            }
+            return Iterator(this, archetypeIndex - 1, position - firstPositions[archetypeIndex - 1]);
+        }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ArchetypeStorage
+///////////////////////////////////////////////////////////////////////////////
+// Component storage backend that groups entities with the same set of
+// components into archetypes. Adding or removing a component moves the entity
+// to another archetype. Selected with -DECS_ARCHETYPE_STORAGE.
+///////////////////////////////////////////////////////////////////////////////
+class ArchetypeStorage {
+    private:
+        struct EntityLocation {
+            Archetype* archetype = nullptr;
+            int row = -1;
+        };
+
+        // All archetypes, indexed by their sorted component ids, and the same list flattened for iteration
+        std::map<std::vector<int>, std::unique_ptr<Archetype>> archetypes;
+        std::vector<Archetype*> archetypeList;
+
+        // Archetypes of the entities that get their first component (index = component id)
+        std::vector<Archetype*> rootEdges;
+
+        // Location of each entity (vector index = entity id)
+        std::vector<EntityLocation> locations;
+
+        Archetype* GetOrCreateArchetype(const std::vector<int>& componentIds, const std::vector<ComponentInfo>& columnInfos) {
+            auto& archetype = archetypes[componentIds];
+            if (!archetype) {
+                archetype = std::make_unique<Archetype>(componentIds, columnInfos);
+                archetypeList.push_back(archetype.get());
+            }
+            return archetype.get();
+        }
+
+        Archetype* GetArchetypeWith(Archetype* source, int componentId, const ComponentInfo& info) {
+            std::vector<Archetype*>& edges = source ? source->addEdges : rootEdges;
+            if (componentId < static_cast<int>(edges.size()) && edges[componentId]) {
+                return edges[componentId];
+            }
+
+            std::vector<int> componentIds = source ? source->componentIds : std::vector<int>();
+            std::vector<ComponentInfo> columnInfos = source ? source->columnInfos : std::vector<ComponentInfo>();
+            const auto position = std::lower_bound(componentIds.begin(), componentIds.end(), componentId);
+            columnInfos.insert(columnInfos.begin() + (position - componentIds.begin()), info);
+            componentIds.insert(position, componentId);
+            Archetype* target = GetOrCreateArchetype(componentIds, columnInfos);
+
+            if (componentId >= static_cast<int>(edges.size())) {
+                edges.resize(componentId + 1, nullptr);
+            }
+            edges[componentId] = target;
+            return target;
+        }
+
+        Archetype* GetArchetypeWithout(Archetype* source, int componentId) {
+            if (componentId < static_cast<int>(source->removeEdges.size()) && source->removeEdges[componentId]) {
+                return source->removeEdges[componentId];
+            }
+
+            std::vector<int> componentIds = source->componentIds;
+            std::vector<ComponentInfo> columnInfos = source->columnInfos;
+            const int column = source->GetColumn(componentId);
+            componentIds.erase(componentIds.begin() + column);
+            columnInfos.erase(columnInfos.begin() + column);
+            Archetype* target = componentIds.empty() ? nullptr : GetOrCreateArchetype(componentIds, columnInfos);
+
+            if (componentId >= static_cast<int>(source->removeEdges.size())) {
+                source->removeEdges.resize(componentId + 1, nullptr);
+            }
+            source->removeEdges[componentId] = target;
+            return target;
+        }
+
+        // Moves all components the entity has in both archetypes into a new row of the target archetype
+        void MoveEntity(int entityId, Archetype* target) {
+            EntityLocation source = locations[entityId];
+            int targetRow = -1;
+            if (target) {
+                targetRow = target->AllocateRow(entityId);
+                for (unsigned int column = 0; source.archetype && column < source.archetype->componentIds.size(); column++) {
+                    const int componentId = source.archetype->componentIds[column];
+                    if (target->HasComponent(componentId)) {
+                        source.archetype->columnInfos[column].moveConstruct(
+                            target->GetComponent(target->GetColumn(componentId), targetRow),
+                            source.archetype->GetComponent(column, source.row)
+                        );
+                    }
+                }
+            }
+            if (source.archetype) {
+                RemoveRow(source.archetype, source.row);
+            }
+            locations[entityId] = { target, targetRow };
+        }
+
+        void RemoveRow(Archetype* archetype, int row) {
+            const int movedEntityId = archetype->RemoveRow(row);
+            if (movedEntityId != -1) {
+                locations[movedEntityId].row = row;
+            }
+        }
+
+    public:
+        template <typename ...TComponents>
+        using ViewType = ArchetypeView<TComponents...>;
+
+        template <typename T>
+        void Add(unsigned int componentId, int entityId, T component) {
+            if (entityId >= static_cast<int>(locations.size())) {
+                locations.resize(entityId + 1);
+            }
+            Archetype* source = locations[entityId].archetype;
+            if (source && source->HasComponent(componentId)) {
+                // The entity already has this component, so we simply replace it
+                Get<T>(componentId, entityId) = std::move(component);
+                return;
+            }
+
+            Archetype* target = GetArchetypeWith(source, componentId, ComponentInfo::Create<T>());
+            MoveEntity(entityId, target);
+            const EntityLocation& location = locations[entityId];
+            new (target->GetComponent(target->GetColumn(componentId), location.row)) T(std::move(component));
+        }
+
+        template <typename T>
+        void Remove(unsigned int componentId, int entityId) {
+            Archetype* source = locations[entityId].archetype;
+            MoveEntity(entityId, GetArchetypeWithout(source, componentId));
+        }
+
+        template <typename T>
+        T& Get(unsigned int componentId, int entityId) const {
+            const EntityLocation& location = locations[entityId];
+            return *static_cast<T*>(location.archetype->GetComponent(location.archetype->GetColumn(componentId), location.row));
+        }
+
+        template <typename TSignature>
+        void RemoveEntity(int entityId, const TSignature& signature) {
+            if (entityId >= static_cast<int>(locations.size()) || !locations[entityId].archetype) {
+                return;
+            }
+            RemoveRow(locations[entityId].archetype, locations[entityId].row);
+            locations[entityId] = EntityLocation();
+        }
+
+        template <typename ...TComponents, typename ...TComponentIds>
+        ArchetypeView<TComponents...> View(TComponentIds ...componentIds) const {
+            return ArchetypeView<TComponents...>(archetypeList, {{ static_cast<int>(componentIds)... }});
+        }
+};
+
+#endif
@@ -1,29 +1,164 @@
 #include "./AssetStore.h"
+#include "./SkylinePacker.h"
+#include "../Logger/Logger.h"
+#include <algorithm>
 #include <SDL2/SDL_image.h>
 
+// Empty pixels between the images of an atlas, so filtering a scaled sprite doesn't blend in its neighbours
+static const int ATLAS_PADDING = 1;
+
 AssetStore::AssetStore() {
-    SDL_Log("Asset Store constructor invoked");
+    LOG_INFO(Assets, "Asset Store constructor invoked");
 }
 
 AssetStore::~AssetStore() {
     ClearAssets();
-    SDL_Log("Asset Store destructor invoked");
+    LOG_INFO(Assets, "Asset Store destructor invoked");
 }
 
 void AssetStore::ClearAssets() {
     for (auto texture: textures) {
-        SDL_DestroyTexture(texture.second);
+        if (texture) {
+            SDL_DestroyTexture(texture);
+        }
     }
     textures.clear();
+    for (auto& slot: textureSlots) {
+        if (slot.region.texture) {
+            slot.region = TextureRegion();
+            slot.isPacked = false;
+            slot.generation++;
+        }
+    }
+}
+
+int AssetStore::AddTextureToList(SDL_Texture* texture) {
+    textures.push_back(texture);
+    return textures.size() - 1;
 }
 
-void AssetStore::AddTexture(SDL_Renderer* renderer, std::string assetId, std::string filePath) {
+TextureHandle AssetStore::SetTextureSlot(const std::string& assetId, const TextureRegion& region, bool isPacked) {
+    const auto slotIndex = textureSlotIndices.emplace(assetId, textureSlots.size());
+    if (slotIndex.second) {
+        textureSlots.emplace_back();
+    }
+    TextureSlot& slot = textureSlots[slotIndex.first->second];
+    if (slot.region.texture) {
+        // An atlas stays loaded for its other images
+        if (!slot.isPacked) {
+            SDL_DestroyTexture(slot.region.texture);
+            textures[slot.region.textureIndex] = nullptr;
+        }
+        slot.generation++;
+    }
+    slot.region = region;
+    slot.isPacked = isPacked;
+    return { slotIndex.first->second, slot.generation };
+}
+
+TextureHandle AssetStore::AddTexture(SDL_Renderer* renderer, std::string assetId, std::string filePath) {
     SDL_Surface* surface = IMG_Load(filePath.c_str());
     SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    TextureRegion region;
+    region.texture = texture;
+    region.rect = { 0, 0, surface ? surface->w : 0, surface ? surface->h : 0 };
+    region.textureIndex = AddTextureToList(texture);
     SDL_FreeSurface(surface);
-    textures.emplace(assetId, texture);
+    return SetTextureSlot(assetId, region, false);
 }
 
-SDL_Texture* AssetStore::GetTexture(std::string assetId) {
-    return textures[assetId];
-}
\ No newline at end of file
+void AssetStore::AddTextureAtlas(SDL_Renderer* renderer, const std::vector<std::pair<std::string, std::string>>& assetFiles, int atlasSize) {
+    struct Image {
+        const std::string* assetId;
+        SDL_Surface* surface;
+        // Atlas of the image (-1 if it has a texture of its own) and its position in it
+        int atlas = -1;
+        int x = 0;
+        int y = 0;
+    };
+    std::vector<Image> images;
+    for (const auto& assetFile: assetFiles) {
+        SDL_Surface* surface = IMG_Load(assetFile.second.c_str());
+        if (!surface) {
+            LOG_ERROR(Assets, "Failed to load image %s (%s) of the texture atlas", assetFile.first.c_str(), assetFile.second.c_str());
+            continue;
+        }
+        images.push_back({ &assetFile.first, surface });
+    }
+
+    // Pack the tallest images first, opening a new atlas when an image fits in none of the open ones
+    std::sort(images.begin(), images.end(), [](const Image& a, const Image& b) {
+        return a.surface->h != b.surface->h ? a.surface->h > b.surface->h : a.surface->w > b.surface->w;
+    });
+    std::vector<SkylinePacker> packers;
+    for (auto& image: images) {
+        const int width = image.surface->w + ATLAS_PADDING;
+        const int height = image.surface->h + ATLAS_PADDING;
+        if (width > atlasSize || height > atlasSize) {
+            continue;
+        }
+        for (size_t atlas = 0; atlas < packers.size() && image.atlas == -1; atlas++) {
+            if (packers[atlas].Pack(width, height, image.x, image.y)) {
+                image.atlas = atlas;
+            }
+        }
+        if (image.atlas == -1) {
+            packers.emplace_back(atlasSize, atlasSize);
+            packers.back().Pack(width, height, image.x, image.y);
+            image.atlas = packers.size() - 1;
+        }
+    }
+
+    // Copy the images into a surface per atlas (only as big as the packed images need) and make the atlas textures
+    for (size_t atlas = 0; atlas < packers.size(); atlas++) {
+        SDL_Surface* atlasSurface = SDL_CreateRGBSurfaceWithFormat(0, packers[atlas].GetUsedWidth(), packers[atlas].GetUsedHeight(), 32, SDL_PIXELFORMAT_RGBA32);
+        for (auto& image: images) {
+            if (image.atlas == static_cast<int>(atlas)) {
+                // Copy the alpha of the image instead of blending it with the empty atlas
+                SDL_SetSurfaceBlendMode(image.surface, SDL_BLENDMODE_NONE);
+                SDL_Rect dstRect = { image.x, image.y, image.surface->w, image.surface->h };
+                SDL_BlitSurface(image.surface, NULL, atlasSurface, &dstRect);
+            }
+        }
+        SDL_Texture* atlasTexture = SDL_CreateTextureFromSurface(renderer, atlasSurface);
+        SDL_FreeSurface(atlasSurface);
+        const int textureIndex = AddTextureToList(atlasTexture);
+        for (auto& image: images) {
+            if (image.atlas == static_cast<int>(atlas)) {
+                TextureRegion region;
+                region.texture = atlasTexture;
+                region.rect = { image.x, image.y, image.surface->w, image.surface->h };
+                region.textureIndex = textureIndex;
+                SetTextureSlot(*image.assetId, region, true);
+            }
+        }
+    }
+
+    // The images that fit in no atlas get a texture of their own
+    int numPacked = images.size();
+    for (auto& image: images) {
+        if (image.atlas == -1) {
+            numPacked--;
+            TextureRegion region;
+            region.texture = SDL_CreateTextureFromSurface(renderer, image.surface);
+            region.rect = { 0, 0, image.surface->w, image.surface->h };
+            region.textureIndex = AddTextureToList(region.texture);
+            SetTextureSlot(*image.assetId, region, false);
+        }
+        SDL_FreeSurface(image.surface);
+    }
+    LOG_INFO(Assets, "Packed %d images into %zu texture atlases", numPacked, packers.size());
+}
+
+TextureHandle AssetStore::GetTextureHandle(const std::string& assetId) const {
+    const auto slotIndex = textureSlotIndices.find(assetId);
+    if (slotIndex == textureSlotIndices.end() || !textureSlots[slotIndex->second].region.texture) {
+        LOG_WARNING(Assets, "Handle asked for texture %s, which isn't loaded", assetId.c_str());
+        return TextureHandle();
+    }
+    return { slotIndex->second, textureSlots[slotIndex->second].generation };
+}
+
+int AssetStore::GetNumTextures() const {
+    return std::count_if(textures.begin(), textures.end(), [](SDL_Texture* texture) { return texture != nullptr; });
+}
@@ -3,18 +3,76 @@
 
 #include <map>
 #include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
 #include <SDL2/SDL.h>
+#include "./TextureHandle.h"
+
+// Where the image of a texture handle is: its own texture or a texture atlas, and its rectangle in it
+struct TextureRegion {
+    SDL_Texture* texture = nullptr;
+    SDL_Rect rect = { 0, 0, 0, 0 };
+    // Index of the texture in the asset store, images packed in the same atlas share it
+    int textureIndex = 0;
+};
 
 class AssetStore {
     private:
-        std::map<std::string, SDL_Texture*> textures;
-    
+        // All textures loaded (images of their own and atlases), destroyed by ClearAssets
+        std::vector<SDL_Texture*> textures;
+
+        // Flat table of the images, indexed by the handles
+        struct TextureSlot {
+            TextureRegion region;
+            // Starts at 1, handles of generation 0 are null
+            uint32_t generation = 1;
+            // Whether the image is in an atlas shared with other images (rather than a texture of its own)
+            bool isPacked = false;
+        };
+        std::vector<TextureSlot> textureSlots;
+
+        // Slot of each asset id, kept when the assets are cleared so a reloaded texture gets the same slot
+        std::map<std::string, uint32_t> textureSlotIndices;
+
+        // Points the slot of the asset id to the region (the handles to what it pointed to become stale)
+        TextureHandle SetTextureSlot(const std::string& assetId, const TextureRegion& region, bool isPacked);
+        int AddTextureToList(SDL_Texture* texture);
+
     public:
         AssetStore();
         ~AssetStore();
+
+        // Destroys all textures, the handles to them become stale
         void ClearAssets();
-        void AddTexture(SDL_Renderer* renderer, std::string assetId, std::string filePath);
-        SDL_Texture* GetTexture(std::string assetId);
+
+        // Loads the texture (replacing the texture of the asset id if there is one, whose handles become stale)
+        TextureHandle AddTexture(SDL_Renderer* renderer, std::string assetId, std::string filePath);
+
+        ///////////////////////////////////////////////////////////////////////
+        // Loads the images, given as (asset id, file path), and packs them
+        // into as few atlas textures of at most atlasSize x atlasSize pixels
+        // as they fit in, so sprites of different images can be drawn
+        // without switching textures. Each asset id gets a handle to its
+        // rectangle in an atlas, and sprite source rectangles stay relative
+        // to their image. Images too big for an atlas get a texture of their
+        // own.
+        ///////////////////////////////////////////////////////////////////////
+        void AddTextureAtlas(SDL_Renderer* renderer, const std::vector<std::pair<std::string, std::string>>& assetFiles, int atlasSize = 2048);
+
+        // Handle of the texture of the asset id, a null handle if it isn't loaded (resolve it once, not per draw)
+        TextureHandle GetTextureHandle(const std::string& assetId) const;
+
+        // Texture and rectangle of the handle, nullptr if the handle is null or stale
+        const TextureRegion* GetTextureRegion(TextureHandle handle) const {
+            if (handle.index >= textureSlots.size() || textureSlots[handle.index].generation != handle.generation) {
+                return nullptr;
+            }
+            return &textureSlots[handle.index].region;
+        }
+
+        // Number of textures loaded (each atlas counts once)
+        int GetNumTextures() const;
 };
 
 #endif
@@ -0,0 +1,119 @@
+#ifndef SKYLINEPACKER_H
+#define SKYLINEPACKER_H
+
+#include <vector>
+#include <climits>
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////////
+// SkylinePacker
+///////////////////////////////////////////////////////////////////////////////
+// Packs rectangles into a width x height area by keeping its skyline: the
+// top edge of the packed rectangles, as segments of the area width at the
+// height they reach. Each rectangle goes where its top would be the lowest
+// (bottom-left rule, the leftmost of equal positions), and the skyline is
+// raised under it. Rectangles packed in order of decreasing height leave
+// little space unused.
+// Example: SkylinePacker packer(2048, 2048); packer.Pack(32, 32, x, y);
+///////////////////////////////////////////////////////////////////////////////
+class SkylinePacker {
+    private:
+        struct Segment {
+            int x;
+            int y;
+            int width;
+        };
+
+        int width;
+        int height;
+        // Segments from left to right, covering the whole width
+        std::vector<Segment> skyline;
+        int usedWidth = 0;
+        int usedHeight = 0;
+
+        // Lowest y where a rectangle of the width fits with its left edge on the segment, -1 if it doesn't fit
+        int GetFitY(size_t segment, int rectWidth, int rectHeight) const {
+            const int x = skyline[segment].x;
+            if (x + rectWidth > width) {
+                return -1;
+            }
+            int y = 0;
+            for (int remaining = rectWidth; remaining > 0; segment++) {
+                y = std::max(y, skyline[segment].y);
+                if (y + rectHeight > height) {
+                    return -1;
+                }
+                remaining -= skyline[segment].width;
+            }
+            return y;
+        }
+
+        // Raises the skyline under the rectangle placed on the segment
+        void AddSegment(size_t segment, int rectWidth, int rectHeight, int y) {
+            const Segment added = { skyline[segment].x, y + rectHeight, rectWidth };
+            skyline.insert(skyline.begin() + segment, added);
+
+            // Cut the segments now under the rectangle
+            const int right = added.x + added.width;
+            size_t next = segment + 1;
+            while (next < skyline.size() && skyline[next].x < right) {
+                const int shrink = right - skyline[next].x;
+                if (shrink < skyline[next].width) {
+                    skyline[next].x += shrink;
+                    skyline[next].width -= shrink;
+                    break;
+                }
+                skyline.erase(skyline.begin() + next);
+            }
+
+            // Merge neighbours at the same height
+            for (size_t i = 0; i + 1 < skyline.size();) {
+                if (skyline[i].y == skyline[i + 1].y) {
+                    skyline[i].width += skyline[i + 1].width;
+                    skyline.erase(skyline.begin() + i + 1);
+                } else {
+                    i++;
+                }
+            }
+        }
+
+    public:
+        SkylinePacker(int width, int height): width(width), height(height) {
+            skyline.push_back({ 0, 0, width });
+        }
+
+        // Finds a place for a rectangle of the size, false if there is no room left for it
+        bool Pack(int rectWidth, int rectHeight, int& x, int& y) {
+            size_t bestSegment = skyline.size();
+            int bestTop = INT_MAX;
+            int bestY = 0;
+            for (size_t segment = 0; segment < skyline.size(); segment++) {
+                const int fitY = GetFitY(segment, rectWidth, rectHeight);
+                if (fitY != -1 && fitY + rectHeight < bestTop) {
+                    bestSegment = segment;
+                    bestTop = fitY + rectHeight;
+                    bestY = fitY;
+                }
+            }
+            if (bestSegment == skyline.size()) {
+                return false;
+            }
+            x = skyline[bestSegment].x;
+            y = bestY;
+            AddSegment(bestSegment, rectWidth, rectHeight, bestY);
+            usedWidth = std::max(usedWidth, x + rectWidth);
+            usedHeight = std::max(usedHeight, y + rectHeight);
+            return true;
+        }
+
+        // Size of the part of the area the packed rectangles cover
+        int GetUsedWidth() const {
+            return usedWidth;
+        }
+
+        int GetUsedHeight() const {
+            return usedHeight;
+        }
+};
+
+#endif
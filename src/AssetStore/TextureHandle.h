@@ -0,0 +1,32 @@
+#ifndef TEXTUREHANDLE_H
+#define TEXTUREHANDLE_H
+
+#include <cstdint>
+
+///////////////////////////////////////////////////////////////////////////////
+// TextureHandle
+///////////////////////////////////////////////////////////////////////////////
+// Stable reference to a texture of the AssetStore: the index of its slot in
+// the texture table and the generation of the slot when the handle was made.
+// Clearing or reloading a texture bumps the generation of its slot, so a
+// stale handle resolves to no texture instead of a destroyed or different
+// one. The default handle (generation 0) never refers to a texture.
+///////////////////////////////////////////////////////////////////////////////
+struct TextureHandle {
+    uint32_t index = 0;
+    uint32_t generation = 0;
+
+    bool IsNull() const {
+        return generation == 0;
+    }
+
+    bool operator ==(const TextureHandle& other) const {
+        return index == other.index && generation == other.generation;
+    }
+
+    bool operator !=(const TextureHandle& other) const {
+        return !(*this == other);
+    }
+};
+
+#endif
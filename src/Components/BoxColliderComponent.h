@@ -2,17 +2,20 @@
 #define BOXCOLLIDERCOMPONENT_H
 
 #include <glm/glm.hpp>
+#include "../Physics/CollisionLayers.h"
 
 class BoxColliderComponent {
     public:
         glm::vec2 offset;
         int width;
         int height;
+        CollisionLayer layer;
 
-        BoxColliderComponent(glm::vec2 offset = glm::vec2(0), int width = 0.0, int height = 0.0) {
+        BoxColliderComponent(glm::vec2 offset = glm::vec2(0), int width = 0.0, int height = 0.0, CollisionLayer layer = CollisionLayer::Default) {
             this->offset = offset;
             this->width = width;
             this->height = height;
+            this->layer = layer;
         }
 };
 
@@ -0,0 +1,28 @@
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include "../ECS/ComponentList.h"
+#include "./AnimationComponent.h"
+#include "./BoxColliderComponent.h"
+#include "./CameraFollowComponent.h"
+#include "./HealthComponent.h"
+#include "./KeyboardControlledComponent.h"
+#include "./ProjectileEmitterComponent.h"
+#include "./RigidBodyComponent.h"
+#include "./SpriteComponent.h"
+#include "./TransformComponent.h"
+
+// All the component types of the game, the position in the list is the component id (new types must be added here)
+typedef ComponentList<
+    TransformComponent,
+    RigidBodyComponent,
+    SpriteComponent,
+    AnimationComponent,
+    BoxColliderComponent,
+    HealthComponent,
+    KeyboardControlledComponent,
+    CameraFollowComponent,
+    ProjectileEmitterComponent
+> RegisteredComponents;
+
+#endif
@@ -6,9 +6,12 @@
 class RigidBodyComponent {
     public:
         glm::vec2 velocity;
+        // Fast movers (like bullets) are swept along their move by the CollisionSystem, so they can't pass through thin colliders
+        bool isFastMover;
 
-        RigidBodyComponent(glm::vec2 velocity = glm::vec2(0)) {
+        RigidBodyComponent(glm::vec2 velocity = glm::vec2(0), bool isFastMover = false) {
             this->velocity = velocity;
+            this->isFastMover = isFastMover;
         }
 };
 
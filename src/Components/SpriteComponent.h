@@ -2,18 +2,20 @@
 #define SPRITECOMPONENT_H
 
 #include <SDL2/SDL.h>
+#include "../AssetStore/TextureHandle.h"
 
 class SpriteComponent {
     public:
-        std::string assetId;
+        // Resolved from the asset id when the sprite is made (AssetStore::GetTextureHandle)
+        TextureHandle texture;
         int width;
         int height;
         int zIndex;
         SDL_Rect srcRect;
         bool isFixed;
         
-        SpriteComponent(std::string assetId = "", int width = 0, int height = 0, int zIndex = 0, bool isFixed = false, int srcRectX = 0, int srcRectY = 0) {
-            this->assetId = assetId;
+        SpriteComponent(TextureHandle texture = TextureHandle(), int width = 0, int height = 0, int zIndex = 0, bool isFixed = false, int srcRectX = 0, int srcRectY = 0) {
+            this->texture = texture;
             this->width = width;
             this->height = height;
             this->zIndex = zIndex;
@@ -8,11 +8,15 @@ class TransformComponent {
         glm::vec2 position;
         glm::vec2 scale;
         double rotation;
+        // Bumped by the code that moves, rotates or scales the entity after it is added, so the systems that keep
+        // something made from the transform (like the sprite bins of the RenderSystem) know to make it again
+        unsigned int version;
         
         TransformComponent(glm::vec2 position = glm::vec2(0), glm::vec2 scale = glm::vec2(0), double rotation = 0.0) {
             this->position = position;
             this->scale = scale;
             this->rotation = rotation;
+            this->version = 0;
         }
 };
 
@@ -0,0 +1,32 @@
+#ifndef COMPONENTLIST_H
+#define COMPONENTLIST_H
+
+#include <type_traits>
+
+///////////////////////////////////////////////////////////////////////////////
+// ComponentList
+///////////////////////////////////////////////////////////////////////////////
+// A list of component types known at compile time. The game registers all its
+// component types in one list (see Components/Components.h), and the id of a
+// component type is its position in that list.
+///////////////////////////////////////////////////////////////////////////////
+template <typename ...TComponents>
+struct ComponentList {
+	static constexpr unsigned int size = sizeof...(TComponents);
+};
+
+// Position of TComponent in the list (the size of the list if it isn't in it)
+template <typename TComponent, typename TList>
+struct ComponentListIndex;
+
+template <typename TComponent>
+struct ComponentListIndex<TComponent, ComponentList<>> {
+	static constexpr unsigned int value = 0;
+};
+
+template <typename TComponent, typename TFirst, typename ...TRest>
+struct ComponentListIndex<TComponent, ComponentList<TFirst, TRest...>> {
+	static constexpr unsigned int value = std::is_same<TComponent, TFirst>::value ? 0 : 1 + ComponentListIndex<TComponent, ComponentList<TRest...>>::value;
+};
+
+#endif
@@ -1,8 +1,11 @@
 #include "ECS.h"
+#include "../Logger/Logger.h"
 
-#include <iostream>
+#include <cstdlib>
 
-int IComponent::nextId = 0;
+thread_local const System* System::runningSystem = nullptr;
+
+thread_local CommandBuffer* CommandBuffer::activeCommandBuffer = nullptr;
 
 int Entity::GetId() const {
 	return id;
@@ -12,25 +15,229 @@ void Entity::Kill() {
 	registry->KillEntity(*this);
 }
 
-std::vector<Entity> System::GetSystemEntities() const {
+const std::vector<Entity>& System::GetSystemEntities() const {
 	return entities;
 }
 
 void System::AddEntityToSystem(Entity entity) {
+	const unsigned int entityId = entity.GetId();
+	if (entityId >= entityIndices.size()) {
+		entityIndices.resize(entityId + 1, -1);
+	}
+	if (entityIndices[entityId] != -1) {
+		return;
+	}
+	entityIndices[entityId] = entities.size();
 	entities.push_back(entity);
+	OnEntityAdded(entity);
 }
 
 void System::RemoveEntityFromSystem(Entity entity) {
-	entities.erase(std::remove_if(entities.begin(), entities.end(),	[&entity](Entity other) {
-		return entity == other;
-	}), entities.end());
+	if (!HasEntity(entity)) {
+		return;
+	}
+
+	// Swap the removed entity with the last one and pop it, so removal is O(1)
+	const int indexOfRemoved = entityIndices[entity.GetId()];
+	const Entity last = entities.back();
+	entities[indexOfRemoved] = last;
+	entityIndices[last.GetId()] = indexOfRemoved;
+	entityIndices[entity.GetId()] = -1;
+	entities.pop_back();
+	OnEntityRemoved(entity);
+}
+
+bool System::HasEntity(Entity entity) const {
+	const unsigned int entityId = entity.GetId();
+	return entityId < entityIndices.size() && entityIndices[entityId] != -1;
 }
 
 const Signature& System::GetComponentSignature() const {
 	return componentSignature;
 }
 
+void System::ChangesEntities() {
+	changesEntities = true;
+}
+
+const Signature& System::GetReadSignature() const {
+	return readSignature;
+}
+
+const Signature& System::GetWriteSignature() const {
+	return writeSignature;
+}
+
+bool System::IsChangingEntities() const {
+	return changesEntities;
+}
+
+bool System::ConflictsWith(const System& other) const {
+	// Two systems conflict when one writes something the other reads or writes
+	const bool writesWhatOtherAccesses = (writeSignature & (other.readSignature | other.writeSignature)).any();
+	const bool otherWritesWhatWeAccess = (other.writeSignature & (readSignature | writeSignature)).any();
+	return writesWhatOtherAccesses || otherWritesWhatWeAccess || (changesEntities && other.changesEntities);
+}
+
+void System::SetRunningSystem(const System* system) {
+	runningSystem = system;
+}
+
+void System::CheckComponentAccess(int componentId, bool isWrite) {
+	if (!runningSystem) {
+		return;
+	}
+	// Systems get mutable references to components, so reading requires either declaration
+	const bool isDeclared = isWrite
+		? runningSystem->writeSignature.test(componentId)
+		: runningSystem->readSignature.test(componentId) || runningSystem->writeSignature.test(componentId);
+	if (!isDeclared) {
+		LOG_ERROR(ECS, "System %s accessed component %d %s without declaring it.", typeid(*runningSystem).name(), componentId, isWrite ? "for writing" : "for reading");
+		Logger::Flush();
+		std::abort();
+	}
+}
+
+void System::CheckEntitiesAccess() {
+	if (runningSystem && !runningSystem->changesEntities) {
+		LOG_ERROR(ECS, "System %s created or killed entities without declaring it.", typeid(*runningSystem).name());
+		Logger::Flush();
+		std::abort();
+	}
+}
+
+int System::AccommodateCommandBuffers(int count) {
+	const int first = numUsedCommandBuffers;
+	numUsedCommandBuffers += count;
+	while (static_cast<int>(commandBuffers.size()) < numUsedCommandBuffers) {
+		commandBuffers.push_back(std::make_unique<CommandBuffer>());
+	}
+	return first;
+}
+
+void System::ReplayCommandBuffers(Registry& registry) {
+	for (int i = 0; i < numUsedCommandBuffers; i++) {
+		commandBuffers[i]->Replay(registry);
+	}
+	numUsedCommandBuffers = 0;
+}
+
+CommandBuffer::~CommandBuffer() {
+	DestroyComponents();
+}
+
+CommandBuffer* CommandBuffer::GetActive() {
+	return activeCommandBuffer;
+}
+
+void CommandBuffer::SetActive(CommandBuffer* commandBuffer) {
+	activeCommandBuffer = commandBuffer;
+}
+
+void* CommandBuffer::Allocate(size_t size, size_t alignment) {
+	blockOffset = (blockOffset + alignment - 1) / alignment * alignment;
+	if (currentBlock < blocks.size() && blockOffset + size <= BLOCK_SIZE) {
+		void* memory = blocks[currentBlock].get() + blockOffset;
+		blockOffset += size;
+		return memory;
+	}
+
+	// Move on to the next block, reusing the ones allocated in previous frames
+	if (currentBlock < blocks.size()) {
+		currentBlock++;
+	}
+	if (currentBlock == blocks.size()) {
+		blocks.push_back(std::unique_ptr<unsigned char[]>(new unsigned char[BLOCK_SIZE]));
+	}
+	blockOffset = size;
+	return blocks[currentBlock].get();
+}
+
+void CommandBuffer::Clear() {
+	reservedEntities.clear();
+	numSpawnedEntities = 0;
+	componentCommands.clear();
+	killedEntities.clear();
+	spawnedEntities.clear();
+	currentBlock = 0;
+	blockOffset = 0;
+}
+
+Entity CommandBuffer::SpawnEntity(Registry* registry) {
+	if (reservesEntityIds) {
+		Entity entity = registry->ReserveEntity();
+		reservedEntities.push_back(entity);
+		return entity;
+	}
+	Entity entity(-1 - numSpawnedEntities++);
+	entity.registry = registry;
+	return entity;
+}
+
+void CommandBuffer::KillEntity(Entity entity) {
+	killedEntities.push_back(entity);
+}
+
+bool CommandBuffer::IsEmpty() const {
+	return reservedEntities.empty() && numSpawnedEntities == 0 && componentCommands.empty() && killedEntities.empty();
+}
+
+Entity CommandBuffer::ResolveEntity(Registry& registry, int entityId) const {
+	// Negative ids refer to the entities spawned by this buffer
+	Entity entity = entityId < 0 ? spawnedEntities[-1 - entityId] : Entity(entityId);
+	entity.registry = &registry;
+	return entity;
+}
+
+void CommandBuffer::Replay(Registry& registry) {
+	for (auto entity: reservedEntities) {
+		registry.MarkEntityDirty(entity);
+	}
+	for (int i = 0; i < numSpawnedEntities; i++) {
+		spawnedEntities.push_back(registry.CreateEntity());
+	}
+	for (auto& command: componentCommands) {
+		command.apply(registry, ResolveEntity(registry, command.entityId), command.component);
+	}
+	for (auto entity: killedEntities) {
+		registry.KillEntity(ResolveEntity(registry, entity.GetId()));
+	}
+	Clear();
+}
+
+void CommandBuffer::DestroyComponents() {
+	for (auto& command: componentCommands) {
+		if (command.discard) {
+			command.discard(command.component);
+		}
+	}
+}
+
+void CommandBuffer::Discard(Registry& registry) {
+	DestroyComponents();
+	for (auto entity: reservedEntities) {
+		registry.ReleaseEntity(entity);
+	}
+	Clear();
+}
+
 Entity Registry::CreateEntity() {
+#ifdef ECS_CHECK_SYSTEM_ACCESS
+	System::CheckEntitiesAccess();
+#endif
+	if (CommandBuffer* commandBuffer = CommandBuffer::GetActive()) {
+		return commandBuffer->SpawnEntity(this);
+	}
+
+	Entity entity = ReserveEntity();
+	MarkEntityDirty(entity);
+
+	LOG_DEBUG(ECS, "Created Entity with ID %d (entity count = %d)", entity.GetId(), numEntities);
+
+	return entity;
+}
+
+Entity Registry::ReserveEntity() {
 	int entityId;
 
 	// If there are no free ids waiting to be reused
@@ -47,41 +254,89 @@ Entity Registry::CreateEntity() {
 
 	Entity entity(entityId);
 	entity.registry = this;
+	return entity;
+}
 
-	createdEntities.insert(entity);
+void Registry::DestroyEntity(Entity entity) {
+	// Remove entity from all systems
+	for (auto& system: systems) {
+		system.second->RemoveEntityFromSystem(entity);
+	}
 
-	std::cout << "Created Entity with ID " << entityId << " (entity count = " << numEntities << ")" << std::endl;
+	ReleaseEntity(entity);
+}
 
-	return entity;
+void Registry::DestroyEntities(const std::vector<Entity>& entities) {
+	// Remove all entities of the batch from one system before moving to the next one
+	for (auto& system: systems) {
+		for (auto entity: entities) {
+			system.second->RemoveEntityFromSystem(entity);
+		}
+	}
+
+	for (auto entity: entities) {
+		ReleaseEntity(entity);
+	}
 }
 
-void Registry::DestroyEntity(Entity entity) {
+void Registry::ReleaseEntity(Entity entity) {
 	const int entityId = entity.GetId();
 	
 	// Make the id available for reuse
 	freeIds.push_back(entityId);
 
+	// Remove the entity components from the storage
+	componentStorage.RemoveEntity(entityId, entityComponentSignatures[entityId]);
+
 	// Reset the component signature for that entity id
 	entityComponentSignatures[entityId].reset();
-	
-	// Remove entity from all systems
-	for (auto system: systems) {
-		system.second->RemoveEntityFromSystem(entity);
-	}
 }
 
 void Registry::KillEntity(Entity entity) {
-	killedEntities.insert(entity);
+#ifdef ECS_CHECK_SYSTEM_ACCESS
+	System::CheckEntitiesAccess();
+#endif
+	if (CommandBuffer* commandBuffer = CommandBuffer::GetActive()) {
+		commandBuffer->KillEntity(entity);
+		return;
+	}
+	const unsigned int entityId = entity.GetId();
+	if (entityId >= isEntityKilled.size()) {
+		isEntityKilled.resize(entityId + 1, false);
+	}
+	if (!isEntityKilled[entityId]) {
+		isEntityKilled[entityId] = true;
+		killedEntities.push_back(entity);
+	}
+}
+
+CommandBuffer& Registry::Commands() {
+	return commands;
+}
+
+void Registry::MarkEntityDirty(Entity entity) {
+	const unsigned int entityId = entity.GetId();
+	if (entityId >= isEntityDirty.size()) {
+		isEntityDirty.resize(entityId + 1, false);
+	}
+	if (!isEntityDirty[entityId]) {
+		isEntityDirty[entityId] = true;
+		dirtyEntities.push_back(entity);
+	}
 }
 
 void Registry::Update() {
-	for (auto entity: createdEntities) {
-		AddEntityToSystems(entity);
+	// Apply the entity changes deferred by parallel loops, always in the same order
+	for (auto system: systemsInOrder) {
+		system->ReplayCommandBuffers(*this);
 	}
-	createdEntities.clear();
+	commands.Replay(*this);
 
+	RefreshDirtyEntities();
+
+	DestroyEntities(killedEntities);
 	for (auto entity: killedEntities) {
-		DestroyEntity(entity);
+		isEntityKilled[entity.GetId()] = false;
 	}
 	killedEntities.clear();
 }
@@ -91,13 +346,42 @@ const Signature& Registry::GetComponentSignature(Entity entity) const {
 	return entityComponentSignatures[entityId];
 }
 
-void Registry::AddEntityToSystems(Entity entity) {
-	const auto &entityComponentSignature = GetComponentSignature(entity);
+void Registry::RefreshDirtyEntities() {
+	// Pack the dirty signatures so they can be matched in batch with SIMD
+	dirtySignatures.clear();
+	for (auto entity: dirtyEntities) {
+		dirtySignatures.push_back(GetComponentSignature(entity));
+	}
+	dirtyMatches.resize(dirtyEntities.size());
+
+	// Re-match all dirty entities against one system before moving to the next one
 	for (auto &system: systems) {
-		const auto &systemComponentSignature = system.second->GetComponentSignature();
-		bool isInterested = (entityComponentSignature & systemComponentSignature) == systemComponentSignature;
-		if (isInterested) {
-			system.second->AddEntityToSystem(entity);
+		Signature::MatchAll(system.second->GetComponentSignature(), dirtySignatures.data(), dirtySignatures.size(), dirtyMatches.data());
+		for (unsigned int i = 0; i < dirtyEntities.size(); i++) {
+			if (dirtyMatches[i]) {
+				system.second->AddEntityToSystem(dirtyEntities[i]);
+			} else {
+				system.second->RemoveEntityFromSystem(dirtyEntities[i]);
+			}
+		}
+	}
+
+	for (auto entity: dirtyEntities) {
+		isEntityDirty[entity.GetId()] = false;
+	}
+	dirtyEntities.clear();
+}
+
+void Registry::SetThreadPool(ThreadPool* threadPool) {
+	this->threadPool = threadPool;
+}
+
+void Registry::ParallelFor(int numChunks, const std::function<void(int)>& body) {
+	if (!threadPool || numChunks <= 1) {
+		for (int chunk = 0; chunk < numChunks; chunk++) {
+			body(chunk);
 		}
+		return;
 	}
-}
\ No newline at end of file
+	threadPool->ParallelFor(numChunks, body);
+}
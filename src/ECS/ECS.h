@@ -4,45 +4,56 @@
 #include <vector>
 #include <deque>
 #include <unordered_map>
-#include <set>
 #include <memory>
 #include <algorithm>
 #include <string>
 #include <cstdint>
-#include <bitset>
 #include <typeindex>
+#include <tuple>
 #include "../Pool/Pool.h"
+#include "../Archetype/Archetype.h"
+#include "../Scheduler/ThreadPool.h"
+#include "./Signature.h"
+#include "./ComponentList.h"
+
+// Header with the RegisteredComponents list of the game (a different list can be given with -DECS_COMPONENT_LIST_HEADER)
+#ifndef ECS_COMPONENT_LIST_HEADER
+#define ECS_COMPONENT_LIST_HEADER "../Components/Components.h"
+#endif
+#include ECS_COMPONENT_LIST_HEADER
 
 const unsigned int MAX_ENTITIES = 5000;
-const unsigned int MAX_COMPONENTS = 32;
+
+// Number of entities processed by each chunk of System::ParallelForEach
+const unsigned int PARALLEL_FOR_CHUNK_SIZE = 4096;
 
 ///////////////////////////////////////////////////////////////////////////////
 // Components
 ///////////////////////////////////////////////////////////////////////////////
-// Components are simple structs (plain data) that hold a numerical Id.
+// Components are simple structs (plain data) that hold a numerical Id. The
+// id is the position of the component type in the RegisteredComponents list,
+// so it is known at compile time and doesn't depend on the order of use.
 ///////////////////////////////////////////////////////////////////////////////
-struct IComponent {
-	protected:
-		static int nextId;
-};
+static_assert(RegisteredComponents::size <= MAX_COMPONENTS, "Too many component types for the signature size (see ECS_MAX_COMPONENTS)");
 
-// Used to assign a unique id to a component type
 template <typename TComponent>
-struct Component: public IComponent {
+struct Component {
+	static constexpr unsigned int id = ComponentListIndex<TComponent, RegisteredComponents>::value;
+	static_assert(id < RegisteredComponents::size, "Component type is not in the RegisteredComponents list");
+
 	// Returns the unique id of Component<T>
-	static int GetId() {
-		static auto id = nextId++;
+	static constexpr int GetId() {
 		return id;
 	}
 };
 
-///////////////////////////////////////////////////////////////////////////////
-// Signature
-///////////////////////////////////////////////////////////////////////////////
-// We use a bitset (1s and 0s) to keep track of which components an entity has
-// and also helps keep track of which entities a system is interested in.
-///////////////////////////////////////////////////////////////////////////////
-typedef std::bitset<MAX_COMPONENTS> Signature;
+// Signature with the given component types, usable as a compile-time mask
+template <typename ...TComponents>
+constexpr Signature MakeSignature() {
+	Signature signature;
+	(signature.set(Component<TComponents>::id), ...);
+	return signature;
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 // Entity
@@ -79,6 +90,77 @@ class Entity {
 		class Registry* registry;
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// CommandBuffer
+///////////////////////////////////////////////////////////////////////////////
+// A command buffer records changes to entities (spawns, kills and component
+// additions/removals) so they can be replayed on the registry later on. While
+// a command buffer is active in a thread the registry records these changes in
+// it instead of applying them, which makes it safe to change entities from
+// code that runs in parallel. Spawned entities get a provisional (negative) id
+// that is only valid to record more commands until the buffer is replayed,
+// unless the buffer reserves entity ids, in which case spawns take a real id
+// right away (only for buffers used from a single thread, like the registry's
+// Commands()). All commands are kept in flat arrays and the components live
+// in memory blocks reused between frames, so recording allocates nothing once
+// the buffer has warmed up.
+///////////////////////////////////////////////////////////////////////////////
+class CommandBuffer {
+	private:
+		struct ComponentCommand {
+			int entityId;
+			void* component;
+			void (*apply)(class Registry& registry, Entity entity, void* component);
+			void (*discard)(void* component);
+		};
+
+		const bool reservesEntityIds;
+		std::vector<Entity> reservedEntities;
+
+		int numSpawnedEntities = 0;
+		std::vector<ComponentCommand> componentCommands;
+		std::vector<Entity> killedEntities;
+
+		// Final entities of the recorded spawns, filled while replaying
+		std::vector<Entity> spawnedEntities;
+
+		// Memory blocks where the recorded components are constructed, kept between frames to avoid allocations
+		static constexpr size_t BLOCK_SIZE = 16 * 1024;
+		std::vector<std::unique_ptr<unsigned char[]>> blocks;
+		size_t currentBlock = 0;
+		size_t blockOffset = 0;
+
+		static thread_local CommandBuffer* activeCommandBuffer;
+
+		void* Allocate(size_t size, size_t alignment);
+		void DestroyComponents();
+		void Clear();
+		Entity ResolveEntity(class Registry& registry, int entityId) const;
+
+	public:
+		explicit CommandBuffer(bool reservesEntityIds = false): reservesEntityIds(reservesEntityIds) {}
+		CommandBuffer(const CommandBuffer&) = delete;
+		~CommandBuffer();
+
+		// Record changes to be applied later
+		Entity SpawnEntity(class Registry* registry);
+		void KillEntity(Entity entity);
+		template <typename TComponent, typename ...TArgs> void AddComponent(Entity entity, TArgs&& ...args);
+		template <typename TComponent> void RemoveComponent(Entity entity);
+
+		bool IsEmpty() const;
+
+		// Apply all recorded changes in the order they were recorded (spawns, components, kills) and clear the buffer
+		void Replay(class Registry& registry);
+
+		// Throw away all recorded changes (reserved entity ids are given back to the registry)
+		void Discard(class Registry& registry);
+
+		// Command buffer where the registry records changes made from the current thread (nullptr = apply directly)
+		static CommandBuffer* GetActive();
+		static void SetActive(CommandBuffer* commandBuffer);
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // System
 ///////////////////////////////////////////////////////////////////////////////
@@ -93,17 +175,135 @@ class System {
 		// List of all entities that the system is interested in
 		std::vector<Entity> entities;
 
+		// Position of each entity in the entities vector (vector index = entity id, -1 = not in the system)
+		std::vector<int> entityIndices;
+
+		// Which component types the system reads and writes in its update, used by the scheduler to run systems in parallel
+		Signature readSignature;
+		Signature writeSignature;
+
+		// Whether the system creates/kills entities (or emits events whose handlers may do it) during its update
+		bool changesEntities = false;
+
+		// System currently being updated by the scheduler in this thread (used to check undeclared accesses)
+		static thread_local const System* runningSystem;
+
+		// Command buffers of the chunks of ParallelForEach, replayed in order by the registry in the next update
+		std::vector<std::unique_ptr<CommandBuffer>> commandBuffers;
+		int numUsedCommandBuffers = 0;
+
+		// Reserves command buffers for the chunks of a ParallelForEach and returns the index of the first one
+		int AccommodateCommandBuffers(int count);
+
 	public:
 		System() = default;
 		virtual ~System() = default;
 
 		void AddEntityToSystem(Entity entity);
 		void RemoveEntityFromSystem(Entity entity);
-		std::vector<Entity> GetSystemEntities() const;
+
+		// Called when an entity starts or stops being part of the system (during the registry update), e.g. to index it
+		virtual void OnEntityAdded(Entity entity) {}
+		virtual void OnEntityRemoved(Entity entity) {}
+
+		bool HasEntity(Entity entity) const;
+		const std::vector<Entity>& GetSystemEntities() const;
 		const Signature& GetComponentSignature() const;
 
 		// Define the component type that the entities must have to be part of the system
 		template <typename TComponent> void RequireComponent();
+
+		// Declare the component types and the entity changes the system accesses in its update
+		template <typename TComponent> void ReadsComponent();
+		template <typename TComponent> void WritesComponent();
+		void ChangesEntities();
+
+		const Signature& GetReadSignature() const;
+		const Signature& GetWriteSignature() const;
+		bool IsChangingEntities() const;
+
+		// Whether both systems can safely be updated at the same time
+		bool ConflictsWith(const System& other) const;
+
+		// Calls the function with (entity, components...) for each entity that has the components, splitting the
+		// entities in chunks that run in parallel. Entity changes made meanwhile are deferred to the next registry update.
+		template <typename ...TComponents, typename TFunction> void ParallelForEach(class Registry& registry, TFunction function);
+		void ReplayCommandBuffers(class Registry& registry);
+
+		// Mark the system as running in the current thread, and check that accesses done meanwhile were declared
+		static void SetRunningSystem(const System* system);
+		static void CheckComponentAccess(int componentId, bool isWrite);
+		static void CheckEntitiesAccess();
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Component storage
+///////////////////////////////////////////////////////////////////////////////
+// The layout used by the registry to keep component data is selected at
+// compile time: by default each component type has its own sparse-set pool,
+// and compiling with -DECS_ARCHETYPE_STORAGE groups entities with the same
+// signature into archetypes with chunked SoA columns.
+///////////////////////////////////////////////////////////////////////////////
+#ifdef ECS_ARCHETYPE_STORAGE
+typedef ArchetypeStorage ComponentStorage;
+#else
+typedef PoolStorage ComponentStorage;
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// ComponentView
+///////////////////////////////////////////////////////////////////////////////
+// A view iterates all entities that have a given set of components and yields
+// references to their components straight from the component storage. It
+// keeps raw pointers to the storage data, so there is no allocation and no
+// shared_ptr refcount traffic while iterating.
+// Example: for (auto [entity, transform, rigidbody]: registry->View<TransformComponent, RigidBodyComponent>())
+// Components must not be added or removed from the viewed types while iterating.
+///////////////////////////////////////////////////////////////////////////////
+template <typename ...TComponents>
+class ComponentView {
+	private:
+		typedef typename ComponentStorage::template ViewType<TComponents...> StorageView;
+
+		class Registry* registry;
+		StorageView storageView;
+
+	public:
+		ComponentView(class Registry* registry, StorageView storageView): registry(registry), storageView(std::move(storageView)) {}
+
+		class Iterator {
+			private:
+				class Registry* registry;
+				typename StorageView::Iterator iterator;
+
+			public:
+				Iterator(class Registry* registry, typename StorageView::Iterator iterator): registry(registry), iterator(iterator) {}
+
+				std::tuple<Entity, TComponents&...> operator *() const {
+					Entity entity(iterator.GetEntityId());
+					entity.registry = registry;
+					return std::tuple<Entity, TComponents&...>(entity, iterator.template Get<TComponents>()...);
+				}
+
+				Iterator& operator ++() {
+					++iterator;
+					return *this;
+				}
+
+				size_t GetPosition() const {
+					return iterator.GetPosition();
+				}
+
+				bool operator ==(const Iterator& other) const { return iterator == other.iterator; }
+				bool operator !=(const Iterator& other) const { return iterator != other.iterator; }
+		};
+
+		Iterator begin() const { return Iterator(registry, storageView.begin()); }
+		Iterator end() const { return Iterator(registry, storageView.end()); }
+
+		// Random access to split the iteration in chunks (positions go from 0 to GetSize())
+		size_t GetSize() const { return storageView.GetSize(); }
+		Iterator At(size_t position) const { return Iterator(registry, storageView.At(position)); }
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -121,19 +321,47 @@ class Registry {
 		// List of free entity Ids that were previously removed
 		std::deque<int> freeIds;
 
-		// Vector of component pools, each pool contains all the data for a certain component type (vector index = component id, pool index = entity id)
-		std::vector<std::shared_ptr<IPool>> componentPools;
+		// Storage with all the component data of the entities (pools or archetypes, see ComponentStorage)
+		ComponentStorage componentStorage;
 
 		// Vector of component signatures (vector index = entity id), the signature lets us know which components are turned "on" for a specific entity
 		std::vector<Signature> entityComponentSignatures;
 
-		// Set of entities that are flagged as killed or created, awaiting creation and destruction in the next registry update
-		std::set<Entity> createdEntities;
-		std::set<Entity> killedEntities;
+		// Entities that were created or had their signature changed, awaiting to be re-matched against the systems in the next registry update
+		std::vector<Entity> dirtyEntities;
+		std::vector<bool> isEntityDirty;
+
+		// Packed copy of the dirty entity signatures and whether each one matches a system (reused every update)
+		std::vector<Signature> dirtySignatures;
+		std::vector<uint8_t> dirtyMatches;
+
+		// Entities that are flagged as killed, awaiting destruction in the next registry update (flags skip double kills)
+		std::vector<Entity> killedEntities;
+		std::vector<bool> isEntityKilled;
+
+		// Changes recorded through Commands(), applied in the next registry update
+		CommandBuffer commands{true};
 
 		// Map of active systems (index = system typeid)
 		std::unordered_map<std::type_index, std::shared_ptr<System>> systems;
 
+		// Same systems in the order they were added, so deferred changes are always applied in the same order
+		std::vector<System*> systemsInOrder;
+
+		// Worker threads used to run parallel loops (nullptr = run them in the calling thread)
+		ThreadPool* threadPool = nullptr;
+
+		// Takes a free entity id without registering the entity anywhere yet
+		Entity ReserveEntity();
+
+		// Frees the entity id, its components and its signature (the systems must be updated separately)
+		void ReleaseEntity(Entity entity);
+
+		// Flags the entity so its system membership is re-evaluated in the next update
+		void MarkEntityDirty(Entity entity);
+
+		friend class CommandBuffer;
+
 	public:
 		Registry() = default;
 
@@ -141,6 +369,10 @@ class Registry {
 		Entity CreateEntity();
 		void KillEntity(Entity entity);    // flag entities to be destroyed in the next update
 		void DestroyEntity(Entity entity); // this effectively removes the recently killed entities from the scene
+		void DestroyEntities(const std::vector<Entity>& entities); // same as above, but for a whole batch of entities at once
+
+		// Command buffer to record entity changes that must wait until the next update (recorded, replayed or discarded as a whole)
+		CommandBuffer& Commands();
 
 		// Updates the systems so that created/deleted entities are removed from the systems' vectors of entities.
 		void Update();
@@ -151,8 +383,12 @@ class Registry {
 		template <typename TSystem> bool HasSystem() const;
 		template <typename TSystem> TSystem& GetSystem() const;
 
-		/* Checks entity component signatures and adds an the entity to each system that is interested in it */
-		void AddEntityToSystems(Entity entity);
+		/* Checks the component signatures of the dirty entities and adds/removes them from each system accordingly */
+		void RefreshDirtyEntities();
+
+		/* Parallel loops */
+		void SetThreadPool(ThreadPool* threadPool);
+		void ParallelFor(int numChunks, const std::function<void(int)>& body);
 
 		template <typename TComponent> std::shared_ptr<Pool<TComponent>> AccommodateComponent();
 		const Signature& GetComponentSignature(Entity entity) const;
@@ -162,12 +398,24 @@ class Registry {
 		template <typename TComponent> void RemoveComponent(Entity entity);
 		template <typename TComponent> bool HasComponent(Entity entity) const;
 		template <typename TComponent> TComponent& GetComponent(Entity entity) const;
+
+		/* Iterate all entities that have the given components */
+		template <typename ...TComponents> ComponentView<TComponents...> View() const;
 };
 
 template <typename TComponent>
 void System::RequireComponent() {
-	const auto componentId = Component<TComponent>::GetId();
-	componentSignature.set(componentId);
+	componentSignature |= MakeSignature<TComponent>();
+}
+
+template <typename TComponent>
+void System::ReadsComponent() {
+	readSignature |= MakeSignature<TComponent>();
+}
+
+template <typename TComponent>
+void System::WritesComponent() {
+	writeSignature |= MakeSignature<TComponent>();
 }
 
 template <typename TSystem, typename ...TArgs>
@@ -177,6 +425,7 @@ void Registry::AddSystem(TArgs && ...args) {
 	}
 	std::shared_ptr<TSystem> newSystem(new TSystem(std::forward<TArgs>(args) ...));
 	systems.insert(std::make_pair(std::type_index(typeid(TSystem)), newSystem));
+	systemsInOrder.push_back(newSystem.get());
 }
 
 template <typename TSystem>
@@ -185,6 +434,7 @@ void Registry::RemoveSystem() {
 		return;
 	}
 	auto system = systems.find(std::type_index(typeid(TSystem)));
+	systemsInOrder.erase(std::find(systemsInOrder.begin(), systemsInOrder.end(), system->second.get()));
 	systems.erase(system);
 }
 
@@ -203,34 +453,41 @@ template <typename TComponent, typename ...TArgs>
 void Registry::AddComponent(Entity entity, TArgs&& ...args) {
 	const auto componentId = Component<TComponent>::GetId();
 	const auto entityId = entity.GetId();
-	
-	if (componentId >= componentPools.size()) {
-		componentPools.resize(componentId + 1, nullptr);
-	}
 
-	if (!componentPools[componentId]) {
-		std::shared_ptr<Pool<TComponent>> newComponentPool = std::make_shared<Pool<TComponent>>();
-		componentPools[componentId] = newComponentPool;
-	}
-
-	std::shared_ptr<Pool<TComponent>> componentPool;
-	componentPool = std::static_pointer_cast<Pool<TComponent>>(componentPools[componentId]);
-
-	if (entityId >= componentPool->GetSize()) {
-		componentPool->Resize(numEntities);
+#ifdef ECS_CHECK_SYSTEM_ACCESS
+	System::CheckComponentAccess(componentId, true);
+#endif
+	if (CommandBuffer* commandBuffer = CommandBuffer::GetActive()) {
+		commandBuffer->AddComponent<TComponent>(entity, std::forward<TArgs>(args)...);
+		return;
 	}
 
 	TComponent newComponent(std::forward<TArgs>(args) ...);
 
-	componentPool->Set(entityId, newComponent);
+	componentStorage.Add<TComponent>(componentId, entityId, std::move(newComponent));
 	entityComponentSignatures[entityId].set(componentId);
+	MarkEntityDirty(entity);
 }
 
 template <typename TComponent>
 void Registry::RemoveComponent(Entity entity) {
 	const auto componentId = Component<TComponent>::GetId();
 	const auto entityId = entity.GetId();
+#ifdef ECS_CHECK_SYSTEM_ACCESS
+	System::CheckComponentAccess(componentId, true);
+#endif
+	if (CommandBuffer* commandBuffer = CommandBuffer::GetActive()) {
+		commandBuffer->RemoveComponent<TComponent>(entity);
+		return;
+	}
+	if (!entityComponentSignatures[entityId].test(componentId)) {
+		return;
+	}
+
+	componentStorage.Remove<TComponent>(componentId, entityId);
+
 	entityComponentSignatures[entityId].set(componentId, false);
+	MarkEntityDirty(entity);
 }
 
 template <typename TComponent>
@@ -244,8 +501,18 @@ template <typename TComponent>
 TComponent& Registry::GetComponent(Entity entity) const {
 	const auto componentId = Component<TComponent>::GetId();
 	const auto entityId = entity.GetId();
-	auto componentPool = std::static_pointer_cast<Pool<TComponent>>(componentPools[componentId]);
-	return componentPool->Get(entityId);
+#ifdef ECS_CHECK_SYSTEM_ACCESS
+	System::CheckComponentAccess(componentId, false);
+#endif
+	return componentStorage.Get<TComponent>(componentId, entityId);
+}
+
+template <typename ...TComponents>
+ComponentView<TComponents...> Registry::View() const {
+#ifdef ECS_CHECK_SYSTEM_ACCESS
+	(System::CheckComponentAccess(Component<TComponents>::GetId(), false), ...);
+#endif
+	return ComponentView<TComponents...>(const_cast<Registry*>(this), componentStorage.View<TComponents...>(Component<TComponents>::GetId()...));
 }
 
 template <typename TComponent, typename ...TArgs>
@@ -268,4 +535,56 @@ TComponent& Entity::GetComponent() const {
 	return registry->GetComponent<TComponent>(*this);
 }
 
+template <typename TComponent, typename ...TArgs>
+void CommandBuffer::AddComponent(Entity entity, TArgs&& ...args) {
+	static_assert(sizeof(TComponent) <= BLOCK_SIZE, "Component is too big to be recorded in a command buffer");
+	ComponentCommand command;
+	command.entityId = entity.GetId();
+	command.component = new (Allocate(sizeof(TComponent), alignof(TComponent))) TComponent(std::forward<TArgs>(args)...);
+	command.apply = [](Registry& registry, Entity entity, void* component) {
+		registry.AddComponent<TComponent>(entity, std::move(*static_cast<TComponent*>(component)));
+		static_cast<TComponent*>(component)->~TComponent();
+	};
+	command.discard = [](void* component) {
+		static_cast<TComponent*>(component)->~TComponent();
+	};
+	componentCommands.push_back(command);
+}
+
+template <typename TComponent>
+void CommandBuffer::RemoveComponent(Entity entity) {
+	ComponentCommand command;
+	command.entityId = entity.GetId();
+	command.component = nullptr;
+	command.apply = [](Registry& registry, Entity entity, void* component) {
+		registry.RemoveComponent<TComponent>(entity);
+	};
+	command.discard = nullptr;
+	componentCommands.push_back(command);
+}
+
+template <typename ...TComponents, typename TFunction>
+void System::ParallelForEach(Registry& registry, TFunction function) {
+	const auto view = registry.View<TComponents...>();
+	const size_t size = view.GetSize();
+	const int numChunks = (size + PARALLEL_FOR_CHUNK_SIZE - 1) / PARALLEL_FOR_CHUNK_SIZE;
+	const int firstCommandBuffer = AccommodateCommandBuffers(numChunks);
+	const System* callerRunningSystem = runningSystem;
+
+	registry.ParallelFor(numChunks, [&](int chunk) {
+		// Each chunk records its entity changes in its own command buffer, so the order they are applied doesn't depend on the threads
+		const System* previousRunningSystem = runningSystem;
+		runningSystem = callerRunningSystem;
+		CommandBuffer::SetActive(commandBuffers[firstCommandBuffer + chunk].get());
+
+		const size_t end = std::min<size_t>(size, (chunk + 1) * PARALLEL_FOR_CHUNK_SIZE);
+		for (auto iterator = view.At(chunk * PARALLEL_FOR_CHUNK_SIZE); iterator.GetPosition() < end; ++iterator) {
+			std::apply(function, *iterator);
+		}
+
+		CommandBuffer::SetActive(nullptr);
+		runningSystem = previousRunningSystem;
+	});
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,159 @@
+#ifndef SIGNATURE_H
+#define SIGNATURE_H
+
+#include <cstdint>
+#include <cstddef>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Number of component types a signature can hold (128 or 256, e.g. -DECS_MAX_COMPONENTS=256)
+#ifndef ECS_MAX_COMPONENTS
+#define ECS_MAX_COMPONENTS 128
+#endif
+
+const unsigned int MAX_COMPONENTS = ECS_MAX_COMPONENTS;
+static_assert(MAX_COMPONENTS == 128 || MAX_COMPONENTS == 256, "Signatures must have 128 or 256 bits");
+
+///////////////////////////////////////////////////////////////////////////////
+// Signature
+///////////////////////////////////////////////////////////////////////////////
+// We use a bitset (1s and 0s) to keep track of which components an entity has
+// and also helps keep track of which entities a system is interested in. The
+// bits are stored in 64-bit words aligned for SIMD loads, so checking if an
+// entity matches a system takes one or two vector instructions, and every
+// operation is constexpr so masks can be built at compile time.
+///////////////////////////////////////////////////////////////////////////////
+class Signature {
+	private:
+		static constexpr unsigned int NUM_WORDS = MAX_COMPONENTS / 64;
+
+		alignas(MAX_COMPONENTS / 8) uint64_t words[NUM_WORDS] = {};
+
+	public:
+		constexpr Signature() = default;
+
+		constexpr Signature& set(unsigned int bit, bool value = true) {
+			if (value) {
+				words[bit / 64] |= uint64_t(1) << (bit % 64);
+			} else {
+				words[bit / 64] &= ~(uint64_t(1) << (bit % 64));
+			}
+			return *this;
+		}
+
+		constexpr Signature& reset() {
+			for (unsigned int i = 0; i < NUM_WORDS; i++) {
+				words[i] = 0;
+			}
+			return *this;
+		}
+
+		constexpr Signature& reset(unsigned int bit) {
+			return set(bit, false);
+		}
+
+		constexpr bool test(unsigned int bit) const {
+			return (words[bit / 64] >> (bit % 64)) & 1;
+		}
+
+		constexpr bool any() const {
+			for (unsigned int i = 0; i < NUM_WORDS; i++) {
+				if (words[i]) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		constexpr bool none() const {
+			return !any();
+		}
+
+		constexpr Signature& operator &=(const Signature& other) {
+			for (unsigned int i = 0; i < NUM_WORDS; i++) {
+				words[i] &= other.words[i];
+			}
+			return *this;
+		}
+
+		constexpr Signature& operator |=(const Signature& other) {
+			for (unsigned int i = 0; i < NUM_WORDS; i++) {
+				words[i] |= other.words[i];
+			}
+			return *this;
+		}
+
+		constexpr Signature operator &(const Signature& other) const {
+			Signature result = *this;
+			return result &= other;
+		}
+
+		constexpr Signature operator |(const Signature& other) const {
+			Signature result = *this;
+			return result |= other;
+		}
+
+		constexpr bool operator ==(const Signature& other) const {
+			for (unsigned int i = 0; i < NUM_WORDS; i++) {
+				if (words[i] != other.words[i]) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		constexpr bool operator !=(const Signature& other) const {
+			return !(*this == other);
+		}
+
+		// Whether every component of the mask is also in this signature
+		bool Includes(const Signature& mask) const {
+#if defined(__AVX2__)
+			if constexpr (NUM_WORDS == 4) {
+				return _mm256_testc_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(words)), _mm256_load_si256(reinterpret_cast<const __m256i*>(mask.words)));
+			}
+#endif
+#if defined(__SSE2__)
+			__m128i missing = _mm_setzero_si128();
+			for (unsigned int i = 0; i < NUM_WORDS; i += 2) {
+				const __m128i signatureWords = _mm_load_si128(reinterpret_cast<const __m128i*>(words + i));
+				const __m128i maskWords = _mm_load_si128(reinterpret_cast<const __m128i*>(mask.words + i));
+				missing = _mm_or_si128(missing, _mm_andnot_si128(signatureWords, maskWords));
+			}
+			return _mm_movemask_epi8(_mm_cmpeq_epi8(missing, _mm_setzero_si128())) == 0xFFFF;
+#else
+			for (unsigned int i = 0; i < NUM_WORDS; i++) {
+				if (mask.words[i] & ~words[i]) {
+					return false;
+				}
+			}
+			return true;
+#endif
+		}
+
+		// Checks a packed batch of signatures against the mask (results[i] = signatures[i] includes the mask)
+		static void MatchAll(const Signature& mask, const Signature* signatures, size_t count, uint8_t* results) {
+			size_t i = 0;
+#if defined(__AVX2__)
+			if constexpr (NUM_WORDS == 2) {
+				// Two signatures per 256-bit register
+				const __m256i maskWords = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(mask.words)));
+				for (; i + 2 <= count; i += 2) {
+					const __m256i signatureWords = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(signatures[i].words));
+					const __m256i missing = _mm256_andnot_si256(signatureWords, maskWords);
+					const int isWordComplete = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(missing, _mm256_setzero_si256())));
+					results[i] = (isWordComplete & 0x3) == 0x3;
+					results[i + 1] = (isWordComplete & 0xC) == 0xC;
+				}
+			}
+#endif
+			for (; i < count; i++) {
+				results[i] = signatures[i].Includes(mask);
+			}
+		}
+};
+
+#endif
@@ -1,13 +1,12 @@
 #ifndef EVENTBUS_H
 #define EVENTBUS_H
 
-#include <iostream>
-
 #include <map>
 #include <list>
 #include <typeindex>
 #include "EventCallback.h"
 #include "Event.h"
+#include "../Logger/Logger.h"
 #include <SDL2/SDL.h>
 
 typedef std::list<std::unique_ptr<IEventCallback>> HandlerList;
@@ -18,17 +17,17 @@ class EventBus {
 
     public:
         EventBus() {
-            SDL_Log("EventBus constructor invoked...");
+            LOG_INFO(Events, "EventBus constructor invoked...");
         };
 
         ~EventBus() {
-            SDL_Log("EventBus destructor invoked...");
+            LOG_INFO(Events, "EventBus destructor invoked...");
         }
 
         void ShowListenerList() {
-            std::cout << "--------------------------------------------------------------" << std::endl;
+            LOG_DEBUG(Events, "--------------------------------------------------------------");
             for (auto l = listeners.begin(); l != listeners.end(); l++) {
-                std::cout << "Listener for " << l->first.name() << " has " << l->second.get()->size() << " events to be handled." << std::endl;
+                LOG_DEBUG(Events, "Listener for %s has %zu events to be handled.", l->first.name(), l->second.get()->size());
              }
         }
 
@@ -0,0 +1,15 @@
+#ifndef COLLISIONBEGINEVENT_H
+#define COLLISIONBEGINEVENT_H
+
+#include "../ECS/ECS.h"
+#include "../EventBus/Event.h"
+
+// Two colliders started touching in this frame
+class CollisionBeginEvent: public Event {
+    public:
+        Entity a;
+        Entity b;
+        CollisionBeginEvent(Entity a, Entity b): a(a), b(b) {}
+};
+
+#endif
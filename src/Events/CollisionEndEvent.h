@@ -0,0 +1,19 @@
+#ifndef COLLISIONENDEVENT_H
+#define COLLISIONENDEVENT_H
+
+#include "../ECS/ECS.h"
+#include "../EventBus/Event.h"
+
+// Two colliders stopped touching in this frame. An entity may have been killed (or lost its collider) since the last
+// frame, it is flagged as removed then: it is no longer a collider, its id may belong to a new entity already, and its
+// components must not be read
+class CollisionEndEvent: public Event {
+    public:
+        Entity a;
+        Entity b;
+        bool isARemoved;
+        bool isBRemoved;
+        CollisionEndEvent(Entity a, Entity b, bool isARemoved = false, bool isBRemoved = false): a(a), b(b), isARemoved(isARemoved), isBRemoved(isBRemoved) {}
+};
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef COLLISIONSTAYEVENT_H
+#define COLLISIONSTAYEVENT_H
+
+#include "../ECS/ECS.h"
+#include "../EventBus/Event.h"
+
+// Two colliders are still touching, emitted every frame for each contact when enabled (see CollisionSystem::SetEmitStayEvents)
+class CollisionStayEvent: public Event {
+    public:
+        Entity a;
+        Entity b;
+        CollisionStayEvent(Entity a, Entity b): a(a), b(b) {}
+};
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef TILECOLLISIONEVENT_H
+#define TILECOLLISIONEVENT_H
+
+#include "../ECS/ECS.h"
+#include "../EventBus/Event.h"
+#include "../Physics/TileCollisionMap.h"
+
+// A collider will be stopped by a map tile that blocks its layer in this frame, and wasn't stopped by a tile of that class in
+// the last frame (a collider that stays against a tile gets the event once)
+class TileCollisionEvent: public Event {
+    public:
+        Entity entity;
+        TileClass tileClass;
+        TileCollisionEvent(Entity entity, TileClass tileClass): entity(entity), tileClass(tileClass) {}
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include "./Game.h"
 #include "../Systems/MovementSystem.h"
 #include "../Systems/CollisionSystem.h"
@@ -12,22 +13,25 @@
 #include "../Systems/RenderColliderSystem.h"
 #include "../Events/KeyPressedEvent.h"
 #include "../Events/KeyReleasedEvent.h"
+#include "../Logger/Logger.h"
 #include <glm/glm.hpp>
 
 int Game::windowWidth = 0;
 int Game::windowHeight = 0;
 int Game::mapWidth = 0;
 int Game::mapHeight = 0;
+int Game::mapTileSize = 0;
 
 Game::Game() {
-    SDL_Log("Game constructor invoked");
+    LOG_INFO(Core, "Game constructor invoked");
     isRunning = false;
     showBoundingBox = false;
     ticksPreviousFrame = 0;
+    frameCount = 0;
 }
 
 Game::~Game() {
-    SDL_Log("Game destructor invoked");
+    LOG_INFO(Core, "Game destructor invoked");
 }
 
 bool Game::IsRunning() const {
@@ -36,7 +40,7 @@ bool Game::IsRunning() const {
 
 void Game::Initialize() {
     if (SDL_Init(SDL_INIT_EVERYTHING) != 0) {
-        std::cerr << "Error initializing SDL." << std::endl;
+        LOG_ERROR(Core, "Error initializing SDL.");
         return;
     }
     SDL_DisplayMode displayMode;
@@ -52,12 +56,12 @@ void Game::Initialize() {
         SDL_WINDOW_BORDERLESS
     );
     if (!window) {
-        std::cerr << "Error creating SDL window." << std::endl;
+        LOG_ERROR(Core, "Error creating SDL window.");
         return;
     }
     renderer = SDL_CreateRenderer(window, -1, 0);
     if (!renderer) {
-        std::cerr << "Error creating SDL renderer." << std::endl;
+        LOG_ERROR(Core, "Error creating SDL renderer.");
         return;
     }
 
@@ -71,9 +75,13 @@ void Game::Initialize() {
     eventBus = std::make_unique<EventBus>();
     assetStore = std::make_unique<AssetStore>();
     registry = std::make_unique<Registry>();
+    scheduler = std::make_unique<Scheduler>();
+    tileCollisionMap = std::make_unique<TileCollisionMap>();
+    tileLayer = std::make_unique<TileLayer>();
+    registry->SetThreadPool(&scheduler->GetThreadPool());
 
     LoadAssets();
-    LoadTileMap("./assets/tilemaps/jungle.map", "tilemap-texture", 25, 20, 32, 2.0);
+    LoadTileMap("./assets/tilemaps/jungle.map", "./assets/tilemaps/jungle.tileclasses", "tilemap-texture", 25, 20, 32, 2.0);
     LoadEntities();
     LoadSystems();
 
@@ -104,6 +112,12 @@ void Game::ProcessInput() {
                 eventBus->EmitEvent<KeyReleasedEvent>(sdlEvent.key.keysym.sym);
                 break;
             }
+            // The render target textures lost their pixels (e.g. Direct3D after a resize or a device loss), the tile
+            // chunks are baked again when they are next seen
+            case SDL_RENDER_TARGETS_RESET:
+            case SDL_RENDER_DEVICE_RESET:
+                tileLayer->ClearChunks();
+                break;
         }
     }
 }
@@ -118,69 +132,148 @@ void Game::LoadSystems() {
     registry->AddSystem<KeyboardControlSystem>();
     registry->AddSystem<CameraMovementSystem>();
     registry->AddSystem<ProjectileSystem>();
+
+    // The collision broadphase uses cells the size of the map tiles (set by LoadTileMap, which runs before)
+    registry->GetSystem<CollisionSystem>().SetCellSize(mapTileSize);
+
+    // Pairs of layers that never need collision events
+    CollisionMatrix& collisionMatrix = registry->GetSystem<CollisionSystem>().GetCollisionMatrix();
+    collisionMatrix.SetInteraction(CollisionLayer::Vegetation, CollisionLayer::Vegetation, false);
+    collisionMatrix.SetInteraction(CollisionLayer::Player, CollisionLayer::PlayerProjectile, false);
+    collisionMatrix.SetInteraction(CollisionLayer::Enemy, CollisionLayer::EnemyProjectile, false);
+    collisionMatrix.SetInteraction(CollisionLayer::PlayerProjectile, CollisionLayer::PlayerProjectile, false);
+    collisionMatrix.SetInteraction(CollisionLayer::PlayerProjectile, CollisionLayer::EnemyProjectile, false);
+    collisionMatrix.SetInteraction(CollisionLayer::EnemyProjectile, CollisionLayer::EnemyProjectile, false);
+    collisionMatrix.SetInteraction(CollisionLayer::LevelComplete, CollisionLayer::Enemy, false);
+    collisionMatrix.SetInteraction(CollisionLayer::LevelComplete, CollisionLayer::Vegetation, false);
+    collisionMatrix.SetInteraction(CollisionLayer::LevelComplete, CollisionLayer::PlayerProjectile, false);
+    collisionMatrix.SetInteraction(CollisionLayer::LevelComplete, CollisionLayer::EnemyProjectile, false);
+
+    // Map tiles that stop each layer: ground vehicles stay on land, the player flies over everything but the map edges
+    tileCollisionMap->SetBlocking(CollisionLayer::Enemy, TileClass::Solid, true);
+    tileCollisionMap->SetBlocking(CollisionLayer::Enemy, TileClass::Water, true);
+    tileCollisionMap->SetBlocking(CollisionLayer::Enemy, TileClass::Blocked, true);
+    tileCollisionMap->SetBlocking(CollisionLayer::Player, TileClass::Blocked, true);
+    tileCollisionMap->SetBlocking(CollisionLayer::PlayerProjectile, TileClass::Solid, true);
+    tileCollisionMap->SetBlocking(CollisionLayer::EnemyProjectile, TileClass::Solid, true);
+    registry->GetSystem<CollisionSystem>().SetTileCollisionMap(tileCollisionMap.get());
+    registry->GetSystem<MovementSystem>().SetTileCollisionMap(tileCollisionMap.get());
+    registry->GetSystem<ProjectileSystem>().SetProjectileTexture(assetStore->GetTextureHandle("bullet-texture"));
+
+    // Add the systems that are updated every frame to the scheduler, conflicting systems will run in this order
+    scheduler->AddSystem(registry->GetSystem<KeyboardControlSystem>(), [this](double deltaTime) {
+        registry->GetSystem<KeyboardControlSystem>().Update(registry);
+    });
+    scheduler->AddSystem(registry->GetSystem<AnimationSystem>(), [this](double deltaTime) {
+        registry->GetSystem<AnimationSystem>().Update(registry);
+    });
+    scheduler->AddSystem(registry->GetSystem<ProjectileSystem>(), [this](double deltaTime) {
+        registry->GetSystem<ProjectileSystem>().Update(registry);
+    });
+    scheduler->AddSystem(registry->GetSystem<CollisionSystem>(), [this](double deltaTime) {
+        registry->GetSystem<CollisionSystem>().Update(registry, eventBus, deltaTime);
+    });
+    scheduler->AddSystem(registry->GetSystem<DamageSystem>(), [this](double deltaTime) {
+        registry->GetSystem<DamageSystem>().Update(registry);
+    });
+    scheduler->AddSystem(registry->GetSystem<MovementSystem>(), [this](double deltaTime) {
+        registry->GetSystem<MovementSystem>().Update(registry, deltaTime);
+    });
+    scheduler->AddSystem(registry->GetSystem<CameraMovementSystem>(), [this](double deltaTime) {
+        registry->GetSystem<CameraMovementSystem>().Update(registry, camera);
+    });
 }
 
 void Game::LoadAssets() {
     assetStore->ClearAssets();
-    assetStore->AddTexture(renderer, "tank-texture", "./assets/images/tank-big-right.png");
-    assetStore->AddTexture(renderer, "truck-texture", "./assets/images/truck-left.png");
-    assetStore->AddTexture(renderer, "chopper-texture", "./assets/images/chopper-spritesheet.png");
-    assetStore->AddTexture(renderer, "bandit-texture", "./assets/images/bandit-spritesheet.png");
-    assetStore->AddTexture(renderer, "base-texture", "./assets/images/base.png");
-    assetStore->AddTexture(renderer, "radar-texture", "./assets/images/radar.png");
-    assetStore->AddTexture(renderer, "bullet-texture", "./assets/images/bullet.png");
-    assetStore->AddTexture(renderer, "tilemap-texture", "./assets/tilemaps/jungle.png");
+
+    // Pack the images into a texture atlas, so the sprites are drawn with few texture switches
+    assetStore->AddTextureAtlas(renderer, {
+        { "tank-texture", "./assets/images/tank-big-right.png" },
+        { "truck-texture", "./assets/images/truck-left.png" },
+        { "chopper-texture", "./assets/images/chopper-spritesheet.png" },
+        { "bandit-texture", "./assets/images/bandit-spritesheet.png" },
+        { "base-texture", "./assets/images/base.png" },
+        { "radar-texture", "./assets/images/radar.png" },
+        { "bullet-texture", "./assets/images/bullet.png" },
+        { "tilemap-texture", "./assets/tilemaps/jungle.png" }
+    });
 }
 
-void Game::LoadTileMap(std::string mapFilePath, std::string textureAssetId, int mapNumCols, int mapNumRows, int tileSize, double scale) {
+void Game::LoadTileMap(std::string mapFilePath, std::string tileClassesFilePath, std::string textureAssetId, int mapNumCols, int mapNumRows, int tileSize, double scale) {
+    // The tiles are drawn by the tile layer and collide through the tile collision map, they aren't entities
+    tileCollisionMap->Resize(mapNumCols, mapNumRows, tileSize * scale);
+    tileLayer->Resize(mapNumCols, mapNumRows, tileSize, scale, assetStore->GetTextureHandle(textureAssetId));
+
+    // The map file has a digit for the row and one for the column of each tile in the tileset, so the tileset has up
+    // to 10x10 tiles. The tile classes file has a line for each row of the tileset with a symbol for each of its tiles
+    // (see TileCollisionMap::GetClassOfSymbol), the tiles it doesn't reach are Empty
+    const int maxTilesetSize = 10;
+    TileClass tileClasses[maxTilesetSize][maxTilesetSize];
+    std::fill(&tileClasses[0][0], &tileClasses[0][0] + maxTilesetSize * maxTilesetSize, TileClass::Empty);
+    std::ifstream tileClassesFile(tileClassesFilePath);
+    if (!tileClassesFile) {
+        LOG_WARNING(Assets, "Failed to open the tile classes file %s, all tiles will be empty", tileClassesFilePath.c_str());
+    }
+    std::string line;
+    for (int tileRow = 0; tileRow < maxTilesetSize && std::getline(tileClassesFile, line); tileRow++) {
+        for (int tileCol = 0; tileCol < maxTilesetSize && tileCol < static_cast<int>(line.size()); tileCol++) {
+            tileClasses[tileRow][tileCol] = TileCollisionMap::GetClassOfSymbol(line[tileCol]);
+        }
+    }
+
     std::fstream mapFile;
     mapFile.open(mapFilePath);
     for (int y = 0; y < mapNumRows; y++) {
         for (int x = 0; x < mapNumCols; x++) {
             char ch;
             mapFile.get(ch);
-            int srcRectY = std::atoi(&ch) * tileSize;
+            int tileRow = std::atoi(&ch);
+            int srcRectY = tileRow * tileSize;
             mapFile.get(ch);
-            int srcRectX = std::atoi(&ch) * tileSize;
+            int tileCol = std::atoi(&ch);
+            int srcRectX = tileCol * tileSize;
             mapFile.ignore();
 
-            Entity tile = registry->CreateEntity();
-            tile.AddComponent<TransformComponent>(glm::vec2(x * (scale * tileSize), y * (scale * tileSize)), glm::vec2(scale, scale), 0.0);
-            tile.AddComponent<SpriteComponent>(textureAssetId, tileSize, tileSize, 0, false, srcRectX, srcRectY);
+            if (tileRow >= 0 && tileRow < maxTilesetSize && tileCol >= 0 && tileCol < maxTilesetSize) {
+                tileCollisionMap->SetTile(x, y, tileClasses[tileRow][tileCol]);
+            }
+            tileLayer->SetTile(x, y, srcRectX, srcRectY);
         }
     }
     mapFile.close();
 
     mapWidth = mapNumCols * tileSize * scale;
     mapHeight = mapNumRows * tileSize * scale;
+    mapTileSize = tileSize * scale;
 }
 
 void Game::LoadEntities() {
     Entity base = registry->CreateEntity();
     base.AddComponent<TransformComponent>(glm::vec2(240, 115), glm::vec2(1, 1), 0.0);
-    base.AddComponent<SpriteComponent>("base-texture", 32, 32, 1);
+    base.AddComponent<SpriteComponent>(assetStore->GetTextureHandle("base-texture"), 32, 32, 1);
 
     Entity tank = registry->CreateEntity();
     tank.AddComponent<TransformComponent>(glm::vec2(800, 150), glm::vec2(1, 1), 0.0);
     tank.AddComponent<HealthComponent>(100);
     tank.AddComponent<RigidBodyComponent>(glm::vec2(3, 0));
-    tank.AddComponent<SpriteComponent>("tank-texture", 32, 32, 2);
-    tank.AddComponent<BoxColliderComponent>(glm::vec2(0, 10), 25, 15);
+    tank.AddComponent<SpriteComponent>(assetStore->GetTextureHandle("tank-texture"), 32, 32, 2);
+    tank.AddComponent<BoxColliderComponent>(glm::vec2(0, 10), 25, 15, CollisionLayer::Enemy);
 
     Entity truck = registry->CreateEntity();
     truck.AddComponent<TransformComponent>(glm::vec2(400, 500), glm::vec2(1, 1), 0.0);
     truck.AddComponent<HealthComponent>(100);
     truck.AddComponent<RigidBodyComponent>(glm::vec2(-5, 0));
-    truck.AddComponent<SpriteComponent>("truck-texture", 32, 32, 2);
-    truck.AddComponent<BoxColliderComponent>(glm::vec2(5, 7), 20, 15);
+    truck.AddComponent<SpriteComponent>(assetStore->GetTextureHandle("truck-texture"), 32, 32, 2);
+    truck.AddComponent<BoxColliderComponent>(glm::vec2(5, 7), 20, 15, CollisionLayer::Enemy);
 
     Entity chopper = registry->CreateEntity();
     chopper.AddComponent<TransformComponent>(glm::vec2(240, 108), glm::vec2(1.2, 1.2), 0.0);
     chopper.AddComponent<HealthComponent>(100);
     chopper.AddComponent<RigidBodyComponent>(glm::vec2(0, 0));
-    chopper.AddComponent<SpriteComponent>("chopper-texture", 32, 32, 3);
+    chopper.AddComponent<SpriteComponent>(assetStore->GetTextureHandle("chopper-texture"), 32, 32, 3);
     chopper.AddComponent<AnimationComponent>(2, 10);
-    chopper.AddComponent<BoxColliderComponent>(glm::vec2(0, 5), 32, 25);
+    chopper.AddComponent<BoxColliderComponent>(glm::vec2(0, 5), 32, 25, CollisionLayer::Player);
     chopper.AddComponent<CameraFollowComponent>();
     chopper.AddComponent<KeyboardControlledComponent>(glm::vec2(0, -60), glm::vec2(60, 0), glm::vec2(0, 60), glm::vec2(-60, 0));
     chopper.AddComponent<ProjectileEmitterComponent>(glm::vec2(100, 100), 5.0, true, true);
@@ -189,14 +282,14 @@ void Game::LoadEntities() {
     // chopper2.AddComponent<TransformComponent>(glm::vec2(240, 160), glm::vec2(1, 1), 0.0);
     // chopper2.AddComponent<HealthComponent>(100);
     // chopper2.AddComponent<RigidBodyComponent>(glm::vec2(0, 0));
-    // chopper2.AddComponent<SpriteComponent>("bandit-texture", 32, 32, 3);
+    // chopper2.AddComponent<SpriteComponent>(assetStore->GetTextureHandle("bandit-texture"), 32, 32, 3);
     // chopper2.AddComponent<AnimationComponent>(2, 10);
     // chopper2.AddComponent<BoxColliderComponent>(glm::vec2(0, 5), 32, 25);
     // chopper2.AddComponent<KeyboardControlledComponent>(glm::vec2(0, -15), glm::vec2(15, 0), glm::vec2(0, 15), glm::vec2(-15, 0));
 
     Entity radar = registry->CreateEntity();
     radar.AddComponent<TransformComponent>(glm::vec2(0, 0), glm::vec2(1, 1), 0.0);
-    radar.AddComponent<SpriteComponent>("radar-texture", 64, 64, 9, true);
+    radar.AddComponent<SpriteComponent>(assetStore->GetTextureHandle("radar-texture"), 64, 64, 9, true);
     radar.AddComponent<AnimationComponent>(8, 5);
 }
 
@@ -220,21 +313,31 @@ void Game::Update() {
     // Update and refresh all entities
     registry->Update();
 
-    // Update all systems that should be executed in the current frame
-    registry->GetSystem<KeyboardControlSystem>().Update(registry);
-    registry->GetSystem<AnimationSystem>().Update(registry);
-    registry->GetSystem<ProjectileSystem>().Update(registry);
-    registry->GetSystem<CollisionSystem>().Update(registry, eventBus);
-    registry->GetSystem<DamageSystem>().Update(registry);
-    registry->GetSystem<MovementSystem>().Update(registry, deltaTime);
-    registry->GetSystem<CameraMovementSystem>().Update(registry, camera);
+    // Update all systems that should be executed in the current frame (non-conflicting systems run in parallel)
+    scheduler->Run(deltaTime);
+
+    // Report once per second how much time running the systems in parallel saved, the collision contacts, the render queue changes and the culled sprites
+    if (++frameCount % FPS == 0) {
+        const SchedulerReport& report = scheduler->GetLastReport();
+        LOG_DEBUG(Scheduler, "Systems took %.3f ms in parallel (%.3f ms one after the other in the last serial frame, %.3f ms saved)", report.parallelMilliseconds, report.serialMilliseconds, report.GetSavedMilliseconds());
+        const ContactCounters& contactCounters = registry->GetSystem<CollisionSystem>().GetContactCounters();
+        LOG_DEBUG(Physics, "%d contacts (%d began, %d ended, %d found by sweeping fast movers in the last frame)", contactCounters.numContacts, contactCounters.numBegins, contactCounters.numEnds, contactCounters.numSweptContacts);
+        LOG_DEBUG(Physics, "%d colliders stopped by map tiles (%d newly in the last frame)", contactCounters.numTileCollisions, contactCounters.numTileBegins);
+        const RenderQueueCounters& renderQueueCounters = registry->GetSystem<RenderSystem>().GetRenderQueueCounters();
+        LOG_DEBUG(Render, "%d sprites in the render queue (%d changed, %d sorted again, %d removed in the last frame)", renderQueueCounters.numItems, renderQueueCounters.numChanged, renderQueueCounters.numSorted, renderQueueCounters.numRemoved);
+        const CullingCounters& cullingCounters = registry->GetSystem<RenderSystem>().GetCullingCounters();
+        LOG_DEBUG(Render, "%d sprites visible, %d culled outside the camera, %d without a loaded texture, %d texture switches", cullingCounters.numVisible, cullingCounters.numCulled, cullingCounters.numWithoutTexture, registry->GetSystem<RenderSystem>().GetNumTextureSwitches());
+        const TileLayerCounters& tileLayerCounters = tileLayer->GetCounters();
+        LOG_DEBUG(Render, "%d tile chunks drawn (%d baked again)", tileLayerCounters.numVisibleChunks, tileLayerCounters.numBakedChunks);
+    }
 }
 
 void Game::Render() {
     SDL_SetRenderDrawColor(renderer, 21, 21, 21, 255);
     SDL_RenderClear(renderer);
 
-    // Call the render system to draw the game objects in our SDL renderer
+    // Draw the map tiles (the chunks of the tile layer that overlap the camera), then the game objects over them
+    tileLayer->Render(renderer, assetStore, camera);
     registry->GetSystem<RenderSystem>().Update(registry, renderer, assetStore, camera);
     
     // Display a red bounding box around entities that collide if "c" is enabled
@@ -246,6 +349,7 @@ void Game::Render() {
 }
 
 void Game::Destroy() {
+    tileLayer->ClearChunks();
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
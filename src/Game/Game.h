@@ -5,6 +5,9 @@
 #include "../ECS/ECS.h"
 #include "../AssetStore/AssetStore.h"
 #include "../EventBus/EventBus.h"
+#include "../Scheduler/Scheduler.h"
+#include "../Physics/TileCollisionMap.h"
+#include "../Render/TileLayer.h"
 #include "../Events/KeyPressedEvent.h"
 
 inline constexpr unsigned int FPS = 60;
@@ -15,6 +18,7 @@ class Game {
         bool isRunning;
         bool showBoundingBox;
         int ticksPreviousFrame;
+        unsigned int frameCount;
         SDL_Window* window;
         SDL_Renderer* renderer;
         SDL_Rect camera;
@@ -22,6 +26,9 @@ class Game {
         std::unique_ptr<AssetStore> assetStore;
         std::unique_ptr<Registry> registry;
         std::unique_ptr<EventBus> eventBus;
+        std::unique_ptr<Scheduler> scheduler;
+        std::unique_ptr<TileCollisionMap> tileCollisionMap;
+        std::unique_ptr<TileLayer> tileLayer;
 
     public:
         Game();
@@ -34,13 +41,14 @@ class Game {
         void LoadAssets();
         void LoadSystems();
         void LoadEntities();
-        void LoadTileMap(std::string mapFilePath, std::string textureAssetId, int mapNumCols, int mapNumRows, int tileSize, double scale);
+        void LoadTileMap(std::string mapFilePath, std::string tileClassesFilePath, std::string textureAssetId, int mapNumCols, int mapNumRows, int tileSize, double scale);
         void Destroy();
 
         static int windowWidth;
         static int windowHeight;
         static int mapWidth;
         static int mapHeight;
+        static int mapTileSize;
 };
 
 #endif
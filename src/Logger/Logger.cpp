@@ -0,0 +1,92 @@
+#include "./Logger.h"
+#include <chrono>
+
+Logger Logger::instance;
+
+static const char* levelNames[] = { "DEBUG", "INFO", "WARNING", "ERROR" };
+static const char* categoryNames[] = { "Core", "ECS", "Scheduler", "Physics", "Events", "Assets", "Render" };
+
+Logger::Logger(): ring(new Slot[RING_SIZE]) {
+    for (size_t i = 0; i < RING_SIZE; i++) {
+        ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    isRunning = true;
+    writer = std::thread(&Logger::WriteMessages, this);
+}
+
+Logger::~Logger() {
+    isRunning = false;
+    writer.join();
+}
+
+Logger::Record* Logger::BeginRecord(size_t& position) {
+    // Claim the next free slot, or give up if the writer didn't catch up yet
+    position = enqueuePosition.load(std::memory_order_relaxed);
+    while (true) {
+        Slot& slot = ring[position & (RING_SIZE - 1)];
+        const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence == position) {
+            if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                return &slot.record;
+            }
+        } else if (sequence < position) {
+            numDroppedMessages.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            position = enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void Logger::EndRecord(size_t position) {
+    ring[position & (RING_SIZE - 1)].sequence.store(position + 1, std::memory_order_release);
+}
+
+void Logger::WriteMessages() {
+    size_t position = 0;
+    size_t numReportedDrops = 0;
+    char message[1024];
+    while (true) {
+        bool wroteMessages = false;
+        Slot* slot = &ring[position & (RING_SIZE - 1)];
+        while (slot->sequence.load(std::memory_order_acquire) == position + 1) {
+            const Record& record = slot->record;
+            record.print(record, message, sizeof(message));
+            FILE* stream = record.level >= LogLevel::Warning ? stderr : stdout;
+            std::fprintf(stream, "[%s] [%s] %s\n", levelNames[static_cast<int>(record.level)], categoryNames[static_cast<int>(record.category)], message);
+
+            // Give the slot back to the producers for the next lap of the ring
+            slot->sequence.store(position + RING_SIZE, std::memory_order_release);
+            position++;
+            slot = &ring[position & (RING_SIZE - 1)];
+            wroteMessages = true;
+        }
+
+        const size_t numDrops = numDroppedMessages.load(std::memory_order_relaxed);
+        if (numDrops != numReportedDrops) {
+            std::fprintf(stderr, "[WARNING] [Core] %zu log messages were dropped because the log buffer was full\n", numDrops - numReportedDrops);
+            numReportedDrops = numDrops;
+        }
+
+        if (wroteMessages) {
+            std::fflush(stdout);
+            std::fflush(stderr);
+            numWrittenMessages.store(position, std::memory_order_release);
+        } else if (!isRunning) {
+            return;
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+void Logger::Flush() {
+    const size_t position = instance.enqueuePosition.load(std::memory_order_acquire);
+    while (instance.isRunning && instance.numWrittenMessages.load(std::memory_order_acquire) < position) {
+        std::this_thread::yield();
+    }
+}
+
+size_t Logger::GetNumDroppedMessages() {
+    return instance.numDroppedMessages.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,199 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <cstddef>
+#include <cstdio>
+#include <new>
+#include <tuple>
+#include <type_traits>
+
+///////////////////////////////////////////////////////////////////////////////
+// Compile-time filters
+///////////////////////////////////////////////////////////////////////////////
+// Messages below LOG_MIN_LEVEL, or whose category bit is not set in the
+// LOG_CATEGORIES mask, are removed at compile time together with their
+// arguments. Example: -DLOG_MIN_LEVEL=2 keeps only warnings and errors.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+#ifndef LOG_CATEGORIES
+#define LOG_CATEGORIES 0xFFFFFFFF
+#endif
+
+enum class LogLevel: int {
+    Debug = 0,
+    Info,
+    Warning,
+    Error
+};
+
+enum class LogCategory: int {
+    Core = 0,
+    ECS,
+    Scheduler,
+    Physics,
+    Events,
+    Assets,
+    Render
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Logger
+///////////////////////////////////////////////////////////////////////////////
+// The logger keeps printing off the hot paths: logging a message only copies
+// the printf-style format string and its arguments into a lock-free ring
+// buffer, and a background thread formats and writes the messages. When the
+// ring buffer is full the message is dropped (and counted) instead of making
+// the caller wait. The format string must be a string literal and arguments
+// must be trivially copyable (numbers, pointers, C strings). C strings are
+// copied into the message, so they may be gone before it is written; all the
+// C strings of a message share MAX_STRINGS_SIZE characters and are cut short
+// past it.
+// Example: LOG_WARNING(Assets, "Texture %s isn't loaded", assetId.c_str());
+///////////////////////////////////////////////////////////////////////////////
+class Logger {
+    private:
+        // Maximum size of the arguments of a single message
+        static constexpr size_t MAX_ARGUMENTS_SIZE = 64;
+
+        // Maximum size of the copied C strings of a single message (with their terminating zeros)
+        static constexpr size_t MAX_STRINGS_SIZE = 128;
+
+        // Number of messages the ring buffer can hold (must be a power of two)
+        static constexpr size_t RING_SIZE = 4096;
+
+        struct Record {
+            LogLevel level;
+            LogCategory category;
+            const char* format;
+            int (*print)(const Record& record, char* buffer, size_t size);
+            alignas(std::max_align_t) unsigned char arguments[MAX_ARGUMENTS_SIZE];
+            char strings[MAX_STRINGS_SIZE];
+        };
+
+        // A C string argument is stored as where its copy starts in the record strings
+        struct StringOffset {
+            unsigned short offset;
+        };
+
+        template <typename T>
+        using StoredArgument = std::conditional_t<std::is_same_v<T, const char*> || std::is_same_v<T, char*>, StringOffset, T>;
+
+        // Ring buffer slot, the sequence tells producers and the writer whose turn it is to use the slot
+        struct Slot {
+            std::atomic<size_t> sequence;
+            Record record;
+        };
+
+        std::unique_ptr<Slot[]> ring;
+        alignas(64) std::atomic<size_t> enqueuePosition{0};
+        alignas(64) std::atomic<size_t> numWrittenMessages{0};
+        std::atomic<size_t> numDroppedMessages{0};
+        std::atomic<bool> isRunning{false};
+        std::thread writer;
+
+        // The only logger, started before main and stopped (after writing all pending messages) when the program exits
+        static Logger instance;
+
+        Logger();
+        ~Logger();
+
+        void WriteMessages();
+        Record* BeginRecord(size_t& position);
+        void EndRecord(size_t position);
+
+        // Copies the string after the ones already in the record, cutting it short when the record strings are full
+        static StringOffset StoreString(Record& record, size_t& stringsSize, const char* text) {
+            if (!text) {
+                text = "(null)";
+            }
+            const size_t start = stringsSize < MAX_STRINGS_SIZE ? stringsSize : MAX_STRINGS_SIZE - 1;
+            size_t end = start;
+            while (end < MAX_STRINGS_SIZE - 1 && *text) {
+                record.strings[end++] = *text++;
+            }
+            record.strings[end] = '\0';
+            stringsSize = end + 1;
+            return { static_cast<unsigned short>(start) };
+        }
+
+        template <typename T>
+        static StoredArgument<T> StoreArgument(Record& record, size_t& stringsSize, T argument) {
+            if constexpr (std::is_same_v<StoredArgument<T>, StringOffset>) {
+                return StoreString(record, stringsSize, argument);
+            } else {
+                return argument;
+            }
+        }
+
+        template <typename T>
+        static T LoadArgument(const Record&, T argument) {
+            return argument;
+        }
+
+        static const char* LoadArgument(const Record& record, StringOffset argument) {
+            return record.strings + argument.offset;
+        }
+
+        template <typename ...TArgs>
+        static int PrintRecord(const Record& record, char* buffer, size_t size) {
+            const auto& arguments = *reinterpret_cast<const std::tuple<StoredArgument<TArgs>...>*>(record.arguments);
+            return std::apply([&](StoredArgument<TArgs> ...args) { return std::snprintf(buffer, size, record.format, LoadArgument(record, args)...); }, arguments);
+        }
+
+    public:
+        Logger(const Logger&) = delete;
+
+        static constexpr bool IsEnabled(LogLevel level, LogCategory category) {
+            return static_cast<int>(level) >= LOG_MIN_LEVEL && ((LOG_CATEGORIES >> static_cast<int>(category)) & 1);
+        }
+
+        template <typename ...TArgs>
+        static void Log(LogLevel level, LogCategory category, const char* format, TArgs ...args) {
+            static_assert((std::is_trivially_copyable<TArgs>::value && ...), "Log arguments must be trivially copyable");
+            static_assert(sizeof(std::tuple<StoredArgument<TArgs>...>) <= MAX_ARGUMENTS_SIZE, "Too many log arguments");
+
+            size_t position;
+            Record* record = instance.BeginRecord(position);
+            if (!record) {
+                return;
+            }
+            record->level = level;
+            record->category = category;
+            record->format = format;
+            record->print = &PrintRecord<TArgs...>;
+            [[maybe_unused]] size_t stringsSize = 0;
+            new (record->arguments) std::tuple<StoredArgument<TArgs>...>{StoreArgument(*record, stringsSize, args)...};
+            instance.EndRecord(position);
+        }
+
+        // Waits until the background thread has written all messages logged so far
+        static void Flush();
+
+        static size_t GetNumDroppedMessages();
+
+        // Never called, only lets the compiler check the format string against the arguments
+        static void CheckFormat(const char* format, ...) __attribute__((format(printf, 1, 2))) {}
+};
+
+#define LOG_MESSAGE(level, category, ...) \
+    do { \
+        if constexpr (Logger::IsEnabled(level, category)) { \
+            if (false) { \
+                Logger::CheckFormat(__VA_ARGS__); \
+            } \
+            Logger::Log(level, category, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_DEBUG(category, ...) LOG_MESSAGE(LogLevel::Debug, LogCategory::category, __VA_ARGS__)
+#define LOG_INFO(category, ...) LOG_MESSAGE(LogLevel::Info, LogCategory::category, __VA_ARGS__)
+#define LOG_WARNING(category, ...) LOG_MESSAGE(LogLevel::Warning, LogCategory::category, __VA_ARGS__)
+#define LOG_ERROR(category, ...) LOG_MESSAGE(LogLevel::Error, LogCategory::category, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////////
+// AABB
+///////////////////////////////////////////////////////////////////////////////
+// Axis-aligned bounding box in world coordinates. Boxes that only touch don't
+// overlap, the same as the collision check of the CollisionSystem.
+///////////////////////////////////////////////////////////////////////////////
+struct AABB {
+    double minX = 0.0;
+    double minY = 0.0;
+    double maxX = 0.0;
+    double maxY = 0.0;
+
+    bool Overlaps(const AABB& other) const {
+        return minX < other.maxX && other.minX < maxX && minY < other.maxY && other.minY < maxY;
+    }
+
+    bool Contains(const AABB& other) const {
+        return minX <= other.minX && minY <= other.minY && other.maxX <= maxX && other.maxY <= maxY;
+    }
+
+    bool Contains(double x, double y) const {
+        return minX <= x && x < maxX && minY <= y && y < maxY;
+    }
+
+    // Whether the segment from (x, y) to (x + dx, y + dy) enters the box before maxFraction (0 = start, 1 = end), and where
+    bool IntersectsSegment(double x, double y, double dx, double dy, double maxFraction, double& fraction) const {
+        double enter = 0.0;
+        double exit = maxFraction;
+        const double start[2] = { x, y };
+        const double delta[2] = { dx, dy };
+        const double boxMin[2] = { minX, minY };
+        const double boxMax[2] = { maxX, maxY };
+        for (int axis = 0; axis < 2; axis++) {
+            if (delta[axis] == 0.0) {
+                if (start[axis] < boxMin[axis] || start[axis] > boxMax[axis]) {
+                    return false;
+                }
+                continue;
+            }
+            double near = (boxMin[axis] - start[axis]) / delta[axis];
+            double far = (boxMax[axis] - start[axis]) / delta[axis];
+            if (near > far) {
+                std::swap(near, far);
+            }
+            enter = std::max(enter, near);
+            exit = std::min(exit, far);
+            if (enter > exit) {
+                return false;
+            }
+        }
+        fraction = enter;
+        return true;
+    }
+
+    // Squared distance from the point to the closest point of the box (0 inside the box)
+    double GetDistanceSquared(double x, double y) const {
+        const double dx = std::max({ minX - x, 0.0, x - maxX });
+        const double dy = std::max({ minY - y, 0.0, y - maxY });
+        return dx * dx + dy * dy;
+    }
+
+    double GetPerimeter() const {
+        return 2.0 * ((maxX - minX) + (maxY - minY));
+    }
+
+    static AABB Union(const AABB& a, const AABB& b) {
+        return { std::min(a.minX, b.minX), std::min(a.minY, b.minY), std::max(a.maxX, b.maxX), std::max(a.maxY, b.maxY) };
+    }
+
+    bool operator ==(const AABB& other) const {
+        return minX == other.minX && minY == other.minY && maxX == other.maxX && maxY == other.maxY;
+    }
+
+    bool operator !=(const AABB& other) const {
+        return !(*this == other);
+    }
+};
+
+#endif
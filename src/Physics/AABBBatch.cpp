@@ -0,0 +1,213 @@
+#include "./AABBBatch.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AABB_BATCH_X86
+#include <immintrin.h>
+#endif
+
+// The kernels test the box with the bounds (minX, minY, maxX, maxY) against the candidates.
+// Candidate k is first + k when testing a range, candidates[k] otherwise
+template <bool isRange>
+static inline int GetCandidate(const int* candidates, int first, int k) {
+    return isRange ? first + k : candidates[k];
+}
+
+template <bool isRange>
+static int OverlapsScalar(const BoxArrays& boxes, const float* bounds, const int* candidates, int first, int count, int* overlapping) {
+    const float minX = bounds[0];
+    const float minY = bounds[1];
+    const float maxX = bounds[2];
+    const float maxY = bounds[3];
+    int numOverlapping = 0;
+    for (int k = 0; k < count; k++) {
+        const int other = GetCandidate<isRange>(candidates, first, k);
+        if (minX < boxes.maxX[other] && boxes.minX[other] < maxX && minY < boxes.maxY[other] && boxes.minY[other] < maxY) {
+            overlapping[numOverlapping++] = other;
+        }
+    }
+    return numOverlapping;
+}
+
+#ifdef AABB_BATCH_X86
+
+template <bool isRange>
+__attribute__((target("sse2")))
+static int OverlapsSSE2(const BoxArrays& boxes, const float* bounds, const int* candidates, int first, int count, int* overlapping) {
+    const __m128 minX = _mm_set1_ps(bounds[0]);
+    const __m128 minY = _mm_set1_ps(bounds[1]);
+    const __m128 maxX = _mm_set1_ps(bounds[2]);
+    const __m128 maxY = _mm_set1_ps(bounds[3]);
+    int numOverlapping = 0;
+    int k = 0;
+    for (; k + 4 <= count; k += 4) {
+        __m128 otherMinX, otherMinY, otherMaxX, otherMaxY;
+        if (isRange) {
+            otherMinX = _mm_loadu_ps(boxes.minX + first + k);
+            otherMinY = _mm_loadu_ps(boxes.minY + first + k);
+            otherMaxX = _mm_loadu_ps(boxes.maxX + first + k);
+            otherMaxY = _mm_loadu_ps(boxes.maxY + first + k);
+        } else {
+            // No gather instruction before AVX2
+            const int* other = candidates + k;
+            otherMinX = _mm_setr_ps(boxes.minX[other[0]], boxes.minX[other[1]], boxes.minX[other[2]], boxes.minX[other[3]]);
+            otherMinY = _mm_setr_ps(boxes.minY[other[0]], boxes.minY[other[1]], boxes.minY[other[2]], boxes.minY[other[3]]);
+            otherMaxX = _mm_setr_ps(boxes.maxX[other[0]], boxes.maxX[other[1]], boxes.maxX[other[2]], boxes.maxX[other[3]]);
+            otherMaxY = _mm_setr_ps(boxes.maxY[other[0]], boxes.maxY[other[1]], boxes.maxY[other[2]], boxes.maxY[other[3]]);
+        }
+        const __m128 overlapX = _mm_and_ps(_mm_cmplt_ps(minX, otherMaxX), _mm_cmplt_ps(otherMinX, maxX));
+        const __m128 overlapY = _mm_and_ps(_mm_cmplt_ps(minY, otherMaxY), _mm_cmplt_ps(otherMinY, maxY));
+        for (int lanes = _mm_movemask_ps(_mm_and_ps(overlapX, overlapY)); lanes != 0; lanes &= lanes - 1) {
+            overlapping[numOverlapping++] = GetCandidate<isRange>(candidates, first, k + __builtin_ctz(lanes));
+        }
+    }
+    return numOverlapping + OverlapsScalar<isRange>(boxes, bounds, isRange ? nullptr : candidates + k, first + k, count - k, overlapping + numOverlapping);
+}
+
+// Loads the values of 8 candidates. Plain loads beat the gather instructions, which are
+// microcoded on many CPUs (and much slower with the Gather Data Sampling mitigation)
+__attribute__((target("avx2")))
+static inline __m256 LoadCandidates8(const float* values, const int* candidates) {
+    const __m128 low = _mm_setr_ps(values[candidates[0]], values[candidates[1]], values[candidates[2]], values[candidates[3]]);
+    const __m128 high = _mm_setr_ps(values[candidates[4]], values[candidates[5]], values[candidates[6]], values[candidates[7]]);
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+}
+
+template <bool isRange>
+__attribute__((target("avx2")))
+static int OverlapsAVX2(const BoxArrays& boxes, const float* bounds, const int* candidates, int first, int count, int* overlapping) {
+    const __m256 minX = _mm256_set1_ps(bounds[0]);
+    const __m256 minY = _mm256_set1_ps(bounds[1]);
+    const __m256 maxX = _mm256_set1_ps(bounds[2]);
+    const __m256 maxY = _mm256_set1_ps(bounds[3]);
+    int numOverlapping = 0;
+    int k = 0;
+    for (; k + 8 <= count; k += 8) {
+        __m256 otherMinX, otherMinY, otherMaxX, otherMaxY;
+        if (isRange) {
+            otherMinX = _mm256_loadu_ps(boxes.minX + first + k);
+            otherMinY = _mm256_loadu_ps(boxes.minY + first + k);
+            otherMaxX = _mm256_loadu_ps(boxes.maxX + first + k);
+            otherMaxY = _mm256_loadu_ps(boxes.maxY + first + k);
+        } else {
+            otherMinX = LoadCandidates8(boxes.minX, candidates + k);
+            otherMinY = LoadCandidates8(boxes.minY, candidates + k);
+            otherMaxX = LoadCandidates8(boxes.maxX, candidates + k);
+            otherMaxY = LoadCandidates8(boxes.maxY, candidates + k);
+        }
+        const __m256 overlapX = _mm256_and_ps(_mm256_cmp_ps(minX, otherMaxX, _CMP_LT_OQ), _mm256_cmp_ps(otherMinX, maxX, _CMP_LT_OQ));
+        const __m256 overlapY = _mm256_and_ps(_mm256_cmp_ps(minY, otherMaxY, _CMP_LT_OQ), _mm256_cmp_ps(otherMinY, maxY, _CMP_LT_OQ));
+        for (int lanes = _mm256_movemask_ps(_mm256_and_ps(overlapX, overlapY)); lanes != 0; lanes &= lanes - 1) {
+            overlapping[numOverlapping++] = GetCandidate<isRange>(candidates, first, k + __builtin_ctz(lanes));
+        }
+    }
+    // The rest runs SSE code, clear the upper halves of the registers so it doesn't pay for mixing both
+    _mm256_zeroupper();
+    return numOverlapping + OverlapsScalar<isRange>(boxes, bounds, isRange ? nullptr : candidates + k, first + k, count - k, overlapping + numOverlapping);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512 LoadCandidates16(const float* values, const int* candidates) {
+    const __m256 low = LoadCandidates8(values, candidates);
+    const __m256 high = LoadCandidates8(values, candidates + 8);
+    // The masked insert takes the low lanes from the widened register and the high ones from a zeroed one, so no
+    // lane is read from the undefined upper half that the widening cast leaves
+    return _mm512_castpd_ps(_mm512_mask_insertf64x4(_mm512_castpd256_pd512(_mm256_castps_pd(low)), 0xF0, _mm512_setzero_pd(), _mm256_castps_pd(high), 1));
+}
+
+template <bool isRange>
+__attribute__((target("avx512f")))
+static int OverlapsAVX512(const BoxArrays& boxes, const float* bounds, const int* candidates, int first, int count, int* overlapping) {
+    const __m512 minX = _mm512_set1_ps(bounds[0]);
+    const __m512 minY = _mm512_set1_ps(bounds[1]);
+    const __m512 maxX = _mm512_set1_ps(bounds[2]);
+    const __m512 maxY = _mm512_set1_ps(bounds[3]);
+    const __m512i laneOffsets = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    int numOverlapping = 0;
+    int k = 0;
+    for (; k + 16 <= count; k += 16) {
+        __m512 otherMinX, otherMinY, otherMaxX, otherMaxY;
+        __m512i other;
+        if (isRange) {
+            other = _mm512_add_epi32(_mm512_set1_epi32(first + k), laneOffsets);
+            otherMinX = _mm512_loadu_ps(boxes.minX + first + k);
+            otherMinY = _mm512_loadu_ps(boxes.minY + first + k);
+            otherMaxX = _mm512_loadu_ps(boxes.maxX + first + k);
+            otherMaxY = _mm512_loadu_ps(boxes.maxY + first + k);
+        } else {
+            other = _mm512_loadu_si512(candidates + k);
+            otherMinX = LoadCandidates16(boxes.minX, candidates + k);
+            otherMinY = LoadCandidates16(boxes.minY, candidates + k);
+            otherMaxX = LoadCandidates16(boxes.maxX, candidates + k);
+            otherMaxY = LoadCandidates16(boxes.maxY, candidates + k);
+        }
+        const __mmask16 lanes =
+            _mm512_cmp_ps_mask(minX, otherMaxX, _CMP_LT_OQ) & _mm512_cmp_ps_mask(otherMinX, maxX, _CMP_LT_OQ) &
+            _mm512_cmp_ps_mask(minY, otherMaxY, _CMP_LT_OQ) & _mm512_cmp_ps_mask(otherMinY, maxY, _CMP_LT_OQ);
+        // Packs the overlapping candidates one after the other, keeping their order
+        _mm512_mask_compressstoreu_epi32(overlapping + numOverlapping, lanes, other);
+        numOverlapping += __builtin_popcount(lanes);
+    }
+    _mm256_zeroupper();
+    return numOverlapping + OverlapsScalar<isRange>(boxes, bounds, isRange ? nullptr : candidates + k, first + k, count - k, overlapping + numOverlapping);
+}
+
+#endif
+
+typedef int (*OverlapsFunction)(const BoxArrays& boxes, const float* bounds, const int* candidates, int first, int count, int* overlapping);
+
+// Functions of each level (indexed by SimdLevel), for candidate lists and for ranges
+#ifdef AABB_BATCH_X86
+static const OverlapsFunction overlapsFunctions[] = { OverlapsScalar<false>, OverlapsSSE2<false>, OverlapsAVX2<false>, OverlapsAVX512<false> };
+static const OverlapsFunction overlapsRangeFunctions[] = { OverlapsScalar<true>, OverlapsSSE2<true>, OverlapsAVX2<true>, OverlapsAVX512<true> };
+#else
+static const OverlapsFunction overlapsFunctions[] = { OverlapsScalar<false>, OverlapsScalar<false>, OverlapsScalar<false>, OverlapsScalar<false> };
+static const OverlapsFunction overlapsRangeFunctions[] = { OverlapsScalar<true>, OverlapsScalar<true>, OverlapsScalar<true>, OverlapsScalar<true> };
+#endif
+
+// Picked the first time it's needed, so it's ready even for code running before main. AVX-512 isn't
+// picked by default: it wasn't faster than AVX2 here and it can lower the clock speed of the CPU
+static SimdLevel& GetCurrentSimdLevel() {
+    static SimdLevel simdLevel = std::min(AABBBatch::GetSupportedSimdLevel(), SimdLevel::AVX2);
+    return simdLevel;
+}
+
+int AABBBatch::Overlaps(const BoxArrays& boxes, int box, const int* candidates, int count, int* overlapping) {
+    const float bounds[4] = { boxes.minX[box], boxes.minY[box], boxes.maxX[box], boxes.maxY[box] };
+    return overlapsFunctions[static_cast<int>(GetCurrentSimdLevel())](boxes, bounds, candidates, 0, count, overlapping);
+}
+
+int AABBBatch::OverlapsRange(const BoxArrays& boxes, int box, int first, int count, int* overlapping) {
+    const float bounds[4] = { boxes.minX[box], boxes.minY[box], boxes.maxX[box], boxes.maxY[box] };
+    return overlapsRangeFunctions[static_cast<int>(GetCurrentSimdLevel())](boxes, bounds, nullptr, first, count, overlapping);
+}
+
+int AABBBatch::OverlapsBoundsRange(const BoxArrays& boxes, float minX, float minY, float maxX, float maxY, int first, int count, int* overlapping) {
+    const float bounds[4] = { minX, minY, maxX, maxY };
+    return overlapsRangeFunctions[static_cast<int>(GetCurrentSimdLevel())](boxes, bounds, nullptr, first, count, overlapping);
+}
+
+SimdLevel AABBBatch::GetSupportedSimdLevel() {
+#ifdef AABB_BATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SimdLevel::SSE2;
+    }
+#endif
+    return SimdLevel::Scalar;
+}
+
+SimdLevel AABBBatch::GetSimdLevel() {
+    return GetCurrentSimdLevel();
+}
+
+void AABBBatch::SetSimdLevel(SimdLevel level) {
+    const SimdLevel supportedLevel = GetSupportedSimdLevel();
+    GetCurrentSimdLevel() = static_cast<int>(level) <= static_cast<int>(supportedLevel) ? level : supportedLevel;
+}
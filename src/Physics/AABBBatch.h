@@ -0,0 +1,51 @@
+#ifndef AABBBATCH_H
+#define AABBBATCH_H
+
+// Bounds of a set of boxes, one array per coordinate (index = box)
+struct BoxArrays {
+    const float* minX;
+    const float* minY;
+    const float* maxX;
+    const float* maxY;
+};
+
+// Instruction sets the batch tests can use, from slowest to fastest
+enum class SimdLevel {
+    Scalar,
+    SSE2,
+    AVX2,
+    AVX512
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// AABBBatch
+///////////////////////////////////////////////////////////////////////////////
+// Tests one box against many candidate boxes at once, 4 (SSE2), 8 (AVX2) or
+// 16 (AVX-512) at a time, and writes the candidates that overlap it in a
+// compact list, in the order they were given. The instruction set is picked
+// at startup with CPUID (up to AVX2, AVX-512 has to be asked for), so the same
+// binary runs on any x86-64 CPU, and every level gives exactly the same
+// results as the scalar one. Boxes that only touch don't overlap, like
+// AABB::Overlaps.
+///////////////////////////////////////////////////////////////////////////////
+class AABBBatch {
+    public:
+        // Writes the candidates whose box overlaps the box to overlapping (room for count values) and returns how many
+        static int Overlaps(const BoxArrays& boxes, int box, const int* candidates, int count, int* overlapping);
+
+        // Same as Overlaps with the candidates first, first + 1, ..., first + count - 1
+        static int OverlapsRange(const BoxArrays& boxes, int box, int first, int count, int* overlapping);
+
+        // Same as OverlapsRange for a box that isn't in the arrays
+        static int OverlapsBoundsRange(const BoxArrays& boxes, float minX, float minY, float maxX, float maxY, int first, int count, int* overlapping);
+
+        // Best level supported by the CPU
+        static SimdLevel GetSupportedSimdLevel();
+
+        static SimdLevel GetSimdLevel();
+
+        // Forces a level (e.g. to compare them), levels the CPU doesn't support fall back to the best one it does
+        static void SetSimdLevel(SimdLevel level);
+};
+
+#endif
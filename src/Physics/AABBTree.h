@@ -0,0 +1,345 @@
+#ifndef AABBTREE_H
+#define AABBTREE_H
+
+#include <vector>
+#include <algorithm>
+#include "./AABB.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// AABBTree
+///////////////////////////////////////////////////////////////////////////////
+// Dynamic bounding volume tree: every leaf holds the box of one proxy, and
+// every inner node the union of the boxes below it, so a query only visits
+// the branches whose box it overlaps. Leaves store a "fat" box (the real box
+// grown by a margin), so a proxy that moves a little stays inside it and the
+// tree is left alone; only when it leaves the fat box is it removed and
+// inserted again, refitting the nodes above it. Insertions pick the sibling
+// that grows the tree the least, and rotations keep the tree balanced.
+///////////////////////////////////////////////////////////////////////////////
+class AABBTree {
+    private:
+        static constexpr int NULL_NODE = -1;
+
+        struct Node {
+            AABB box;
+            // Parent of the node, or next free node when the node isn't used
+            int parent;
+            int child1;
+            int child2;
+            // Leaves have height 0, free nodes -1
+            int height;
+            int userData;
+
+            bool IsLeaf() const {
+                return child1 == NULL_NODE;
+            }
+        };
+
+        std::vector<Node> nodes;
+        int root = NULL_NODE;
+        int freeNodes = NULL_NODE;
+        double margin;
+
+        int AllocateNode() {
+            if (freeNodes == NULL_NODE) {
+                nodes.emplace_back();
+                freeNodes = nodes.size() - 1;
+                nodes[freeNodes].parent = NULL_NODE;
+            }
+            const int node = freeNodes;
+            freeNodes = nodes[node].parent;
+            nodes[node].parent = NULL_NODE;
+            nodes[node].child1 = NULL_NODE;
+            nodes[node].child2 = NULL_NODE;
+            nodes[node].height = 0;
+            nodes[node].userData = -1;
+            return node;
+        }
+
+        void FreeNode(int node) {
+            nodes[node].parent = freeNodes;
+            nodes[node].height = -1;
+            freeNodes = node;
+        }
+
+        AABB Fatten(const AABB& box) const {
+            return { box.minX - margin, box.minY - margin, box.maxX + margin, box.maxY + margin };
+        }
+
+        // Updates the heights and boxes from the node up to the root, balancing the tree on the way
+        void Refit(int node) {
+            while (node != NULL_NODE) {
+                node = Balance(node);
+                Node& current = nodes[node];
+                current.height = 1 + std::max(nodes[current.child1].height, nodes[current.child2].height);
+                current.box = AABB::Union(nodes[current.child1].box, nodes[current.child2].box);
+                node = current.parent;
+            }
+        }
+
+        void InsertLeaf(int leaf) {
+            if (root == NULL_NODE) {
+                root = leaf;
+                nodes[root].parent = NULL_NODE;
+                return;
+            }
+
+            // Go down the tree choosing the child whose box grows the least with the new leaf
+            const AABB leafBox = nodes[leaf].box;
+            int sibling = root;
+            while (!nodes[sibling].IsLeaf()) {
+                const Node& node = nodes[sibling];
+                const double combinedPerimeter = AABB::Union(node.box, leafBox).GetPerimeter();
+                // Cost of pairing the leaf with this node, and the cost of going further down
+                const double cost = 2.0 * combinedPerimeter;
+                const double inheritanceCost = 2.0 * (combinedPerimeter - node.box.GetPerimeter());
+                double childCosts[2];
+                const int children[2] = { node.child1, node.child2 };
+                for (int i = 0; i < 2; i++) {
+                    const Node& child = nodes[children[i]];
+                    const double perimeter = AABB::Union(child.box, leafBox).GetPerimeter();
+                    childCosts[i] = (child.IsLeaf() ? perimeter : perimeter - child.box.GetPerimeter()) + inheritanceCost;
+                }
+                if (cost < childCosts[0] && cost < childCosts[1]) {
+                    break;
+                }
+                sibling = childCosts[0] < childCosts[1] ? children[0] : children[1];
+            }
+
+            // Put a new parent in place of the sibling, with the sibling and the leaf as children
+            const int oldParent = nodes[sibling].parent;
+            const int newParent = AllocateNode();
+            nodes[newParent].parent = oldParent;
+            nodes[newParent].box = AABB::Union(leafBox, nodes[sibling].box);
+            nodes[newParent].height = nodes[sibling].height + 1;
+            nodes[newParent].child1 = sibling;
+            nodes[newParent].child2 = leaf;
+            nodes[sibling].parent = newParent;
+            nodes[leaf].parent = newParent;
+            if (oldParent == NULL_NODE) {
+                root = newParent;
+            } else if (nodes[oldParent].child1 == sibling) {
+                nodes[oldParent].child1 = newParent;
+            } else {
+                nodes[oldParent].child2 = newParent;
+            }
+
+            Refit(newParent);
+        }
+
+        void RemoveLeaf(int leaf) {
+            if (leaf == root) {
+                root = NULL_NODE;
+                return;
+            }
+
+            // The sibling takes the place of the parent
+            const int parent = nodes[leaf].parent;
+            const int grandParent = nodes[parent].parent;
+            const int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+            nodes[sibling].parent = grandParent;
+            FreeNode(parent);
+            if (grandParent == NULL_NODE) {
+                root = sibling;
+                return;
+            }
+            if (nodes[grandParent].child1 == parent) {
+                nodes[grandParent].child1 = sibling;
+            } else {
+                nodes[grandParent].child2 = sibling;
+            }
+            Refit(grandParent);
+        }
+
+        // If one child of the node is more than one level taller than the other, rotates it up and returns it
+        int Balance(int a) {
+            if (nodes[a].IsLeaf() || nodes[a].height < 2) {
+                return a;
+            }
+            const int b = nodes[a].child1;
+            const int c = nodes[a].child2;
+            const int balance = nodes[c].height - nodes[b].height;
+            if (balance > 1) {
+                RotateUp(a, c, b, false);
+                return c;
+            }
+            if (balance < -1) {
+                RotateUp(a, b, c, true);
+                return b;
+            }
+            return a;
+        }
+
+        // Makes the taller child of a the parent of a, and moves the shorter child of the taller one under a
+        void RotateUp(int a, int taller, int shorter, bool isTallerFirstChild) {
+            const int f = nodes[taller].child1;
+            const int g = nodes[taller].child2;
+
+            nodes[taller].child1 = a;
+            nodes[taller].parent = nodes[a].parent;
+            nodes[a].parent = taller;
+            const int parent = nodes[taller].parent;
+            if (parent == NULL_NODE) {
+                root = taller;
+            } else if (nodes[parent].child1 == a) {
+                nodes[parent].child1 = taller;
+            } else {
+                nodes[parent].child2 = taller;
+            }
+
+            // The taller grandchild stays under the rotated node, the other one goes under a
+            const int kept = nodes[f].height > nodes[g].height ? f : g;
+            const int moved = kept == f ? g : f;
+            nodes[taller].child2 = kept;
+            if (isTallerFirstChild) {
+                nodes[a].child1 = moved;
+            } else {
+                nodes[a].child2 = moved;
+            }
+            nodes[moved].parent = a;
+            nodes[a].box = AABB::Union(nodes[shorter].box, nodes[moved].box);
+            nodes[a].height = 1 + std::max(nodes[shorter].height, nodes[moved].height);
+            nodes[taller].box = AABB::Union(nodes[a].box, nodes[kept].box);
+            nodes[taller].height = 1 + std::max(nodes[a].height, nodes[kept].height);
+        }
+
+        template <typename TCallback>
+        bool QueryNode(int node, const AABB& box, TCallback& callback) const {
+            const Node& current = nodes[node];
+            if (!current.box.Overlaps(box)) {
+                return true;
+            }
+            if (current.IsLeaf()) {
+                return callback(node);
+            }
+            return QueryNode(current.child1, box, callback) && QueryNode(current.child2, box, callback);
+        }
+
+        template <typename TCallback>
+        bool QueryPointNode(int node, double x, double y, TCallback& callback) const {
+            const Node& current = nodes[node];
+            if (!current.box.Contains(x, y)) {
+                return true;
+            }
+            if (current.IsLeaf()) {
+                return callback(node);
+            }
+            return QueryPointNode(current.child1, x, y, callback) && QueryPointNode(current.child2, x, y, callback);
+        }
+
+        template <typename TCallback>
+        void RayCastNode(int node, double x, double y, double dx, double dy, double& maxFraction, TCallback& callback) const {
+            const Node& current = nodes[node];
+            double fraction;
+            if (!current.box.IntersectsSegment(x, y, dx, dy, maxFraction, fraction)) {
+                return;
+            }
+            if (current.IsLeaf()) {
+                maxFraction = callback(node, maxFraction);
+                return;
+            }
+            RayCastNode(current.child1, x, y, dx, dy, maxFraction, callback);
+            RayCastNode(current.child2, x, y, dx, dy, maxFraction, callback);
+        }
+
+        template <typename TCallback>
+        void QueryNearestNode(int node, double x, double y, double& maxDistanceSquared, TCallback& callback) const {
+            const Node& current = nodes[node];
+            if (current.IsLeaf()) {
+                maxDistanceSquared = callback(node, maxDistanceSquared);
+                return;
+            }
+            // The nearer child first, so the farther one is more likely to be pruned
+            int children[2] = { current.child1, current.child2 };
+            double distancesSquared[2] = { nodes[children[0]].box.GetDistanceSquared(x, y), nodes[children[1]].box.GetDistanceSquared(x, y) };
+            if (distancesSquared[1] < distancesSquared[0]) {
+                std::swap(children[0], children[1]);
+                std::swap(distancesSquared[0], distancesSquared[1]);
+            }
+            for (int i = 0; i < 2; i++) {
+                if (distancesSquared[i] <= maxDistanceSquared) {
+                    QueryNearestNode(children[i], x, y, maxDistanceSquared, callback);
+                }
+            }
+        }
+
+    public:
+        AABBTree(double margin = 0.0): margin(margin) {}
+
+        // Adds a proxy for the box and returns its id
+        int CreateProxy(const AABB& box, int userData) {
+            const int proxy = AllocateNode();
+            nodes[proxy].box = Fatten(box);
+            nodes[proxy].userData = userData;
+            InsertLeaf(proxy);
+            return proxy;
+        }
+
+        void DestroyProxy(int proxy) {
+            RemoveLeaf(proxy);
+            FreeNode(proxy);
+        }
+
+        // Moves the proxy to the box, returns whether the proxy had to be inserted again (the box left the fat box)
+        bool MoveProxy(int proxy, const AABB& box) {
+            if (nodes[proxy].box.Contains(box)) {
+                return false;
+            }
+            RemoveLeaf(proxy);
+            nodes[proxy].box = Fatten(box);
+            InsertLeaf(proxy);
+            return true;
+        }
+
+        void SetUserData(int proxy, int userData) {
+            nodes[proxy].userData = userData;
+        }
+
+        int GetUserData(int proxy) const {
+            return nodes[proxy].userData;
+        }
+
+        const AABB& GetFatBox(int proxy) const {
+            return nodes[proxy].box;
+        }
+
+        int GetHeight() const {
+            return root == NULL_NODE ? 0 : nodes[root].height;
+        }
+
+        // Calls callback(proxy) for the proxies whose fat box overlaps the box, until it returns false
+        template <typename TCallback>
+        void Query(const AABB& box, TCallback callback) const {
+            if (root != NULL_NODE) {
+                QueryNode(root, box, callback);
+            }
+        }
+
+        // Calls callback(proxy) for the proxies whose fat box contains the point, until it returns false
+        template <typename TCallback>
+        void QueryPoint(double x, double y, TCallback callback) const {
+            if (root != NULL_NODE) {
+                QueryPointNode(root, x, y, callback);
+            }
+        }
+
+        // Calls callback(proxy, maxFraction) for the proxies whose fat box is crossed by the segment from (x0, y0) to
+        // (x1, y1) before maxFraction; the callback returns the new maxFraction (e.g. the fraction of a hit to clip the ray)
+        template <typename TCallback>
+        void RayCast(double x0, double y0, double x1, double y1, double maxFraction, TCallback callback) const {
+            if (root != NULL_NODE) {
+                RayCastNode(root, x0, y0, x1 - x0, y1 - y0, maxFraction, callback);
+            }
+        }
+
+        // Calls callback(proxy, maxDistanceSquared) for the proxies whose fat box is at most sqrt(maxDistanceSquared) from
+        // the point, nearest branches first; the callback returns the new maxDistanceSquared (e.g. to keep the k nearest)
+        template <typename TCallback>
+        void QueryNearest(double x, double y, double maxDistanceSquared, TCallback callback) const {
+            if (root != NULL_NODE && nodes[root].box.GetDistanceSquared(x, y) <= maxDistanceSquared) {
+                QueryNearestNode(root, x, y, maxDistanceSquared, callback);
+            }
+        }
+};
+
+#endif
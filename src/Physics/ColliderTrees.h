@@ -0,0 +1,283 @@
+#ifndef COLLIDERTREES_H
+#define COLLIDERTREES_H
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include "./AABB.h"
+#include "./AABBTree.h"
+
+// Result of a raycast against the colliders
+struct RaycastHit {
+    int id = -1;
+    // Position of the hit along the ray (0 = start, 1 = end)
+    double fraction = 1.0;
+    double x = 0.0;
+    double y = 0.0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ColliderTrees
+///////////////////////////////////////////////////////////////////////////////
+// Keeps the colliders in two AABB trees: one for the static colliders, which
+// are inserted once and never move, and one for the dynamic ones, whose fat
+// boxes let them move a little without touching the tree. Pairs are found by
+// querying both trees with each dynamic collider only, so two static
+// colliders are never tested against each other. Pairs whose layers don't
+// interact are dropped before the narrowphase, and a tree isn't queried at all
+// by a collider that doesn't interact with any layer in it. The same trees
+// answer point, box, circle, ray and nearest queries against the colliders of
+// the last update, filtered by layer.
+// Colliders are tracked across updates by a caller-given id (e.g. the entity id).
+///////////////////////////////////////////////////////////////////////////////
+class ColliderTrees {
+    private:
+        struct Collider {
+            AABB box;
+            uint32_t layerBits = 0;
+            uint32_t layerMask = 0;
+            int proxy = -1;
+            int index = -1;
+            bool isStatic = false;
+            unsigned int lastFrame = 0;
+        };
+
+        AABBTree staticTree;
+        AABBTree dynamicTree;
+        unsigned int frame = 0;
+
+        std::vector<Collider> colliderOfId;
+        std::vector<int> trackedIds;
+        std::vector<int> dynamicIds;
+
+        // Layers of the colliders in each tree
+        uint32_t staticLayerBits = 0;
+        uint32_t dynamicLayerBits = 0;
+
+        AABBTree& GetTree(const Collider& collider) {
+            return collider.isStatic ? staticTree : dynamicTree;
+        }
+
+        // Removes the colliders that weren't in this update from their tree
+        void RemoveStaleColliders() {
+            for (unsigned int i = 0; i < trackedIds.size();) {
+                Collider& collider = colliderOfId[trackedIds[i]];
+                if (collider.lastFrame == frame) {
+                    i++;
+                    continue;
+                }
+                GetTree(collider).DestroyProxy(collider.proxy);
+                collider.proxy = -1;
+                trackedIds[i] = trackedIds.back();
+                trackedIds.pop_back();
+            }
+        }
+
+    public:
+        // Dynamic boxes can move this far (in pixels) before they have to be inserted again
+        ColliderTrees(double dynamicMargin = 8.0): staticTree(0.0), dynamicTree(dynamicMargin) {}
+
+        // Updates the trees with the colliders of this frame, colliders that aren't given anymore are removed
+        void Update(const int* ids, const uint8_t* isStatic, const float* minX, const float* minY, const float* maxX, const float* maxY, const uint32_t* layerBits, const uint32_t* layerMasks, int count) {
+            frame++;
+            dynamicIds.clear();
+            staticLayerBits = 0;
+            dynamicLayerBits = 0;
+            for (int index = 0; index < count; index++) {
+                const int id = ids[index];
+                if (id >= static_cast<int>(colliderOfId.size())) {
+                    colliderOfId.resize(id + 1);
+                }
+                Collider& collider = colliderOfId[id];
+                const AABB box = { minX[index], minY[index], maxX[index], maxY[index] };
+                if (collider.proxy != -1 && collider.isStatic != static_cast<bool>(isStatic[index])) {
+                    // Changed trees (e.g. the entity got a rigid body)
+                    GetTree(collider).DestroyProxy(collider.proxy);
+                    collider.proxy = -1;
+                    trackedIds.erase(std::find(trackedIds.begin(), trackedIds.end(), id));
+                }
+                if (collider.proxy == -1) {
+                    collider.isStatic = isStatic[index];
+                    collider.proxy = GetTree(collider).CreateProxy(box, id);
+                    trackedIds.push_back(id);
+                } else if (collider.box != box) {
+                    GetTree(collider).MoveProxy(collider.proxy, box);
+                }
+                collider.box = box;
+                collider.layerBits = layerBits[index];
+                collider.layerMask = layerMasks[index];
+                collider.index = index;
+                collider.lastFrame = frame;
+                if (collider.isStatic) {
+                    staticLayerBits |= collider.layerBits;
+                } else {
+                    dynamicIds.push_back(id);
+                    dynamicLayerBits |= collider.layerBits;
+                }
+            }
+            RemoveStaleColliders();
+        }
+
+        // Index in the last update of the collider with the id
+        int GetIndex(int id) const {
+            return colliderOfId[id].index;
+        }
+
+        // Writes the pairs (i, j), i < j, of colliders (by index in the last update) that may overlap and whose layers
+        // interact, sorted by i and then j
+        void FindPairs(std::vector<std::pair<int, int>>& pairs) const {
+            pairs.clear();
+            for (auto id: dynamicIds) {
+                const Collider& collider = colliderOfId[id];
+                // Both colliders of a dynamic pair find each other, only the one with the lower index reports it
+                if (collider.layerMask & dynamicLayerBits) {
+                    dynamicTree.Query(collider.box, [&](int proxy) {
+                        const Collider& other = colliderOfId[dynamicTree.GetUserData(proxy)];
+                        if (other.index > collider.index && (collider.layerMask & other.layerBits)) {
+                            pairs.emplace_back(collider.index, other.index);
+                        }
+                        return true;
+                    });
+                }
+                if (collider.layerMask & staticLayerBits) {
+                    staticTree.Query(collider.box, [&](int proxy) {
+                        const Collider& other = colliderOfId[staticTree.GetUserData(proxy)];
+                        if (collider.layerMask & other.layerBits) {
+                            pairs.emplace_back(std::min(collider.index, other.index), std::max(collider.index, other.index));
+                        }
+                        return true;
+                    });
+                }
+            }
+            std::sort(pairs.begin(), pairs.end());
+        }
+
+        // Appends the ids of the colliders that contain the point
+        void QueryPoint(double x, double y, std::vector<int>& ids) const {
+            auto addIfContains = [&](const AABBTree& tree) {
+                tree.QueryPoint(x, y, [&](int proxy) {
+                    const int id = tree.GetUserData(proxy);
+                    if (colliderOfId[id].box.Contains(x, y)) {
+                        ids.push_back(id);
+                    }
+                    return true;
+                });
+            };
+            addIfContains(staticTree);
+            addIfContains(dynamicTree);
+        }
+
+        // Appends the ids of the colliders that overlap the box
+        void QueryBox(const AABB& box, std::vector<int>& ids) const {
+            auto addIfOverlaps = [&](const AABBTree& tree) {
+                tree.Query(box, [&](int proxy) {
+                    const int id = tree.GetUserData(proxy);
+                    if (colliderOfId[id].box.Overlaps(box)) {
+                        ids.push_back(id);
+                    }
+                    return true;
+                });
+            };
+            addIfOverlaps(staticTree);
+            addIfOverlaps(dynamicTree);
+        }
+
+        // Calls callback(id) for the colliders of the layers in the mask that overlap the box, until it returns false
+        template <typename TCallback>
+        void QueryBox(const AABB& box, uint32_t layerMask, TCallback callback) const {
+            bool shouldContinue = true;
+            auto visit = [&](const AABBTree& tree) {
+                tree.Query(box, [&](int proxy) {
+                    const int id = tree.GetUserData(proxy);
+                    const Collider& collider = colliderOfId[id];
+                    if ((collider.layerBits & layerMask) && collider.box.Overlaps(box)) {
+                        shouldContinue = callback(id);
+                    }
+                    return shouldContinue;
+                });
+            };
+            if (layerMask & staticLayerBits) {
+                visit(staticTree);
+            }
+            if (shouldContinue && (layerMask & dynamicLayerBits)) {
+                visit(dynamicTree);
+            }
+        }
+
+        // Calls callback(id) for the colliders of the layers in the mask that overlap the circle, until it returns false
+        template <typename TCallback>
+        void QueryCircle(double x, double y, double radius, uint32_t layerMask, TCallback callback) const {
+            const AABB bounds = { x - radius, y - radius, x + radius, y + radius };
+            QueryBox(bounds, layerMask, [&](int id) {
+                return colliderOfId[id].box.GetDistanceSquared(x, y) < radius * radius ? callback(id) : true;
+            });
+        }
+
+        // Calls callback(id, distanceSquared) for the colliders of the layers in the mask at most sqrt(maxDistanceSquared)
+        // from the point, nearest branches first; the callback returns the new maxDistanceSquared (e.g. to keep the k nearest)
+        template <typename TCallback>
+        void QueryNearest(double x, double y, uint32_t layerMask, double maxDistanceSquared, TCallback callback) const {
+            auto visit = [&](const AABBTree& tree) {
+                tree.QueryNearest(x, y, maxDistanceSquared, [&](int proxy, double) {
+                    const int id = tree.GetUserData(proxy);
+                    const Collider& collider = colliderOfId[id];
+                    const double distanceSquared = collider.box.GetDistanceSquared(x, y);
+                    if ((collider.layerBits & layerMask) && distanceSquared <= maxDistanceSquared) {
+                        maxDistanceSquared = callback(id, distanceSquared);
+                    }
+                    return maxDistanceSquared;
+                });
+            };
+            if (layerMask & staticLayerBits) {
+                visit(staticTree);
+            }
+            if (layerMask & dynamicLayerBits) {
+                visit(dynamicTree);
+            }
+        }
+
+        // Finds the first collider of the layers in the mask crossed by the segment from (x0, y0) to (x1, y1), returns
+        // whether there was one
+        bool Raycast(double x0, double y0, double x1, double y1, RaycastHit& hit, uint32_t layerMask = ~uint32_t(0)) const {
+            hit = RaycastHit();
+            auto clipToClosest = [&](const AABBTree& tree) {
+                tree.RayCast(x0, y0, x1, y1, hit.fraction, [&](int proxy, double maxFraction) {
+                    const int id = tree.GetUserData(proxy);
+                    double fraction;
+                    if (!(colliderOfId[id].layerBits & layerMask) || !colliderOfId[id].box.IntersectsSegment(x0, y0, x1 - x0, y1 - y0, maxFraction, fraction)) {
+                        return maxFraction;
+                    }
+                    if (hit.id != -1 && fraction == hit.fraction && id > hit.id) {
+                        // Same distance as the current hit, keep the lowest id so the result doesn't depend on the trees
+                        return maxFraction;
+                    }
+                    hit.id = id;
+                    hit.fraction = fraction;
+                    return fraction;
+                });
+            };
+            if (layerMask & staticLayerBits) {
+                clipToClosest(staticTree);
+            }
+            if (layerMask & dynamicLayerBits) {
+                clipToClosest(dynamicTree);
+            }
+            if (hit.id == -1) {
+                return false;
+            }
+            hit.x = x0 + (x1 - x0) * hit.fraction;
+            hit.y = y0 + (y1 - y0) * hit.fraction;
+            return true;
+        }
+
+        int GetNumStaticColliders() const {
+            return trackedIds.size() - dynamicIds.size();
+        }
+
+        int GetNumDynamicColliders() const {
+            return dynamicIds.size();
+        }
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef COLLISIONLAYERS_H
+#define COLLISIONLAYERS_H
+
+#include <cstdint>
+
+const unsigned int MAX_COLLISION_LAYERS = 32;
+
+// Layer of a collider, after the collider tags of the level scripts
+enum class CollisionLayer: uint8_t {
+    Default,
+    Player,
+    Enemy,
+    Vegetation,
+    LevelComplete,
+    PlayerProjectile,
+    EnemyProjectile
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CollisionMatrix
+///////////////////////////////////////////////////////////////////////////////
+// Which collision layers interact with which. Each layer has a mask with one
+// bit per layer it interacts with, so checking if two colliders can collide
+// is a single AND of the mask of one with the layer bit of the other, done
+// before any box is tested. By default every layer interacts with every other.
+///////////////////////////////////////////////////////////////////////////////
+class CollisionMatrix {
+    private:
+        uint32_t masks[MAX_COLLISION_LAYERS];
+
+    public:
+        CollisionMatrix() {
+            for (unsigned int layer = 0; layer < MAX_COLLISION_LAYERS; layer++) {
+                masks[layer] = ~uint32_t(0);
+            }
+        }
+
+        static uint32_t GetLayerBit(CollisionLayer layer) {
+            return uint32_t(1) << static_cast<unsigned int>(layer);
+        }
+
+        // Layers that interact with the layer, one bit per layer
+        uint32_t GetMask(CollisionLayer layer) const {
+            return masks[static_cast<unsigned int>(layer)];
+        }
+
+        void SetInteraction(CollisionLayer a, CollisionLayer b, bool shouldInteract) {
+            if (shouldInteract) {
+                masks[static_cast<unsigned int>(a)] |= GetLayerBit(b);
+                masks[static_cast<unsigned int>(b)] |= GetLayerBit(a);
+            } else {
+                masks[static_cast<unsigned int>(a)] &= ~GetLayerBit(b);
+                masks[static_cast<unsigned int>(b)] &= ~GetLayerBit(a);
+            }
+        }
+
+        bool Interact(CollisionLayer a, CollisionLayer b) const {
+            return (GetMask(a) & GetLayerBit(b)) != 0;
+        }
+};
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef SPATIALHASHGRID_H
+#define SPATIALHASHGRID_H
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////////
+// SpatialHashGrid
+///////////////////////////////////////////////////////////////////////////////
+// Broadphase that puts each box in the cells of a uniform grid it overlaps.
+// The cells are hashed into a table sized after the number of boxes, so the
+// grid doesn't need to know the size of the world. Two boxes are candidates
+// to collide if they share a cell, and each pair is only reported by the cell
+// holding the top-left corner of their overlap, so no pair shows up twice.
+// Boxes whose layers don't interact are never paired, and boxes that don't
+// interact with any layer aren't put in the grid at all.
+///////////////////////////////////////////////////////////////////////////////
+class SpatialHashGrid {
+    private:
+        struct CellEntry {
+            int cellX;
+            int cellY;
+            int box;
+        };
+
+        double cellSize = 64.0;
+
+        // Cell entries of all boxes, and the same entries grouped by hash bucket
+        std::vector<CellEntry> entries;
+        std::vector<CellEntry> bucketEntries;
+        std::vector<int> bucketStarts;
+
+        // First cell covered by each box, used to report each pair from a single cell
+        std::vector<int> firstCellX;
+        std::vector<int> firstCellY;
+
+        int GetCell(double coordinate) const {
+            return static_cast<int>(std::floor(coordinate / cellSize));
+        }
+
+        static uint32_t Hash(int cellX, int cellY) {
+            return static_cast<uint32_t>(cellX) * 73856093u ^ static_cast<uint32_t>(cellY) * 19349663u;
+        }
+
+    public:
+        SpatialHashGrid(double cellSize = 64.0): cellSize(cellSize) {}
+
+        // Cells must have a positive size (the boxes are divided by it), other sizes are rejected and the grid keeps its cell size
+        bool SetCellSize(double cellSize) {
+            if (!(cellSize > 0.0)) {
+                return false;
+            }
+            this->cellSize = cellSize;
+            return true;
+        }
+
+        double GetCellSize() const {
+            return cellSize;
+        }
+
+        // Rebuilds the grid with the boxes and writes the pairs (i, j), i < j, of boxes that share a cell and whose
+        // layers interact (layerMasks[i] has the bit of layerBits[j]), sorted by i and then j
+        void FindPairs(const float* minX, const float* minY, const float* maxX, const float* maxY, const uint32_t* layerBits, const uint32_t* layerMasks, int count, std::vector<std::pair<int, int>>& pairs) {
+            pairs.clear();
+            entries.clear();
+            firstCellX.resize(count);
+            firstCellY.resize(count);
+            for (int box = 0; box < count; box++) {
+                if (layerMasks[box] == 0) {
+                    continue;
+                }
+                const int cellMinX = GetCell(minX[box]);
+                const int cellMinY = GetCell(minY[box]);
+                const int cellMaxX = GetCell(maxX[box]);
+                const int cellMaxY = GetCell(maxY[box]);
+                firstCellX[box] = cellMinX;
+                firstCellY[box] = cellMinY;
+                for (int cellY = cellMinY; cellY <= cellMaxY; cellY++) {
+                    for (int cellX = cellMinX; cellX <= cellMaxX; cellX++) {
+                        entries.push_back({ cellX, cellY, box });
+                    }
+                }
+            }
+
+            // Group the entries by bucket with a counting sort (the number of buckets is a power of two)
+            unsigned int numBuckets = 1;
+            while (numBuckets < 2 * entries.size()) {
+                numBuckets *= 2;
+            }
+            bucketStarts.assign(numBuckets + 1, 0);
+            for (const auto& entry: entries) {
+                bucketStarts[(Hash(entry.cellX, entry.cellY) & (numBuckets - 1)) + 1]++;
+            }
+            for (unsigned int bucket = 0; bucket < numBuckets; bucket++) {
+                bucketStarts[bucket + 1] += bucketStarts[bucket];
+            }
+            bucketEntries.resize(entries.size());
+            for (const auto& entry: entries) {
+                bucketEntries[bucketStarts[Hash(entry.cellX, entry.cellY) & (numBuckets - 1)]++] = entry;
+            }
+
+            // After placing the entries each start points to the end of its bucket, which is the start of the next one
+            int bucketStart = 0;
+            for (unsigned int bucket = 0; bucket < numBuckets; bucket++) {
+                const int bucketEnd = bucketStarts[bucket];
+                for (int p = bucketStart; p < bucketEnd; p++) {
+                    const CellEntry& a = bucketEntries[p];
+                    for (int q = p + 1; q < bucketEnd; q++) {
+                        const CellEntry& b = bucketEntries[q];
+                        // Different cells can share a bucket
+                        if (a.cellX != b.cellX || a.cellY != b.cellY) {
+                            continue;
+                        }
+                        if ((layerMasks[a.box] & layerBits[b.box]) == 0) {
+                            continue;
+                        }
+                        // Only the cell where the overlap of both boxes starts reports the pair
+                        if (a.cellX != std::max(firstCellX[a.box], firstCellX[b.box]) || a.cellY != std::max(firstCellY[a.box], firstCellY[b.box])) {
+                            continue;
+                        }
+                        pairs.emplace_back(std::min(a.box, b.box), std::max(a.box, b.box));
+                    }
+                }
+                bucketStart = bucketEnd;
+            }
+
+            std::sort(pairs.begin(), pairs.end());
+        }
+};
+
+#endif
@@ -0,0 +1,241 @@
+#ifndef SWEEPANDPRUNE_H
+#define SWEEPANDPRUNE_H
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_set>
+
+///////////////////////////////////////////////////////////////////////////////
+// SweepAndPrune
+///////////////////////////////////////////////////////////////////////////////
+// Broadphase that keeps the endpoints (min and max) of every box sorted along
+// each axis from one frame to the next. As most boxes barely move, the lists
+// are almost sorted already, and an insertion sort fixes them with a few
+// swaps. Each swap of a min endpoint with a max endpoint is where a pair
+// starts or stops overlapping on that axis, so the set of overlapping pairs is
+// also kept up to date with the swaps instead of being searched every frame.
+// Boxes are tracked across frames by a caller-given id (e.g. the entity id).
+// Pairs whose layers don't interact are skipped before their boxes are
+// compared, and boxes that don't interact with any layer aren't tracked.
+///////////////////////////////////////////////////////////////////////////////
+class SweepAndPrune {
+    private:
+        struct Proxy {
+            double min[2];
+            double max[2];
+            uint32_t layerBits;
+            uint32_t layerMask;
+            int id;
+            int box;
+            unsigned int lastFrame;
+        };
+
+        struct Endpoint {
+            double value;
+            int proxy;
+            bool isMin;
+
+            // At equal values max endpoints go first, so touching boxes don't overlap (like the narrowphase)
+            bool operator <(const Endpoint& other) const {
+                return value < other.value || (value == other.value && !isMin && other.isMin);
+            }
+        };
+
+        std::vector<Proxy> proxies;
+        std::vector<int> freeProxies;
+        std::vector<int> proxyOfId;
+        std::vector<bool> isProxyRemoved;
+        unsigned int frame = 0;
+
+        // Sorted endpoints of each axis
+        std::vector<Endpoint> endpoints[2];
+
+        // Pairs of proxies whose boxes overlap (key = lower proxy << 32 | higher proxy)
+        std::unordered_set<uint64_t> overlappingPairs;
+
+        // Proxies whose interval contains the current position of the sweep, used when rebuilding
+        std::vector<int> activeProxies;
+
+        static uint64_t GetPairKey(int a, int b) {
+            return (static_cast<uint64_t>(std::min(a, b)) << 32) | static_cast<uint32_t>(std::max(a, b));
+        }
+
+        bool Overlap(int a, int b) const {
+            const Proxy& p = proxies[a];
+            const Proxy& q = proxies[b];
+            if ((p.layerMask & q.layerBits) == 0) {
+                return false;
+            }
+            return p.min[0] < q.max[0] && q.min[0] < p.max[0] && p.min[1] < q.max[1] && q.min[1] < p.max[1];
+        }
+
+        int CreateProxy(int id) {
+            int proxy;
+            if (freeProxies.empty()) {
+                proxy = proxies.size();
+                proxies.emplace_back();
+                isProxyRemoved.push_back(false);
+            } else {
+                proxy = freeProxies.back();
+                freeProxies.pop_back();
+                isProxyRemoved[proxy] = false;
+            }
+            proxies[proxy].id = id;
+            if (id >= static_cast<int>(proxyOfId.size())) {
+                proxyOfId.resize(id + 1, -1);
+            }
+            proxyOfId[id] = proxy;
+
+            // The new endpoints start at the end of the lists and the insertion sort moves them into place
+            for (int axis = 0; axis < 2; axis++) {
+                endpoints[axis].push_back({ 0.0, proxy, true });
+                endpoints[axis].push_back({ 0.0, proxy, false });
+            }
+            return proxy;
+        }
+
+        // Removes the proxies that had no box in this frame, with their endpoints and pairs
+        void RemoveStaleProxies() {
+            bool hasRemovedProxies = false;
+            for (unsigned int proxy = 0; proxy < proxies.size(); proxy++) {
+                if (!isProxyRemoved[proxy] && proxies[proxy].lastFrame != frame) {
+                    isProxyRemoved[proxy] = true;
+                    if (proxyOfId[proxies[proxy].id] == static_cast<int>(proxy)) {
+                        proxyOfId[proxies[proxy].id] = -1;
+                    }
+                    freeProxies.push_back(proxy);
+                    hasRemovedProxies = true;
+                }
+            }
+            if (!hasRemovedProxies) {
+                return;
+            }
+            for (int axis = 0; axis < 2; axis++) {
+                auto& axisEndpoints = endpoints[axis];
+                axisEndpoints.erase(std::remove_if(axisEndpoints.begin(), axisEndpoints.end(), [this](const Endpoint& endpoint) {
+                    return isProxyRemoved[endpoint.proxy];
+                }), axisEndpoints.end());
+            }
+            for (auto pair = overlappingPairs.begin(); pair != overlappingPairs.end();) {
+                if (isProxyRemoved[*pair >> 32] || isProxyRemoved[*pair & 0xFFFFFFFF]) {
+                    pair = overlappingPairs.erase(pair);
+                } else {
+                    ++pair;
+                }
+            }
+        }
+
+        void UpdateEndpoints(int axis) {
+            for (auto& endpoint: endpoints[axis]) {
+                const Proxy& proxy = proxies[endpoint.proxy];
+                endpoint.value = endpoint.isMin ? proxy.min[axis] : proxy.max[axis];
+            }
+        }
+
+        // Sorts both axes from scratch and finds all overlapping pairs with a single sweep, for when many boxes are new
+        void Rebuild() {
+            for (int axis = 0; axis < 2; axis++) {
+                UpdateEndpoints(axis);
+                std::sort(endpoints[axis].begin(), endpoints[axis].end());
+            }
+
+            overlappingPairs.clear();
+            activeProxies.clear();
+            for (const auto& endpoint: endpoints[0]) {
+                if (!endpoint.isMin) {
+                    continue;
+                }
+                // Drop the proxies that end before this one starts, and check the rest
+                const double start = endpoint.value;
+                activeProxies.erase(std::remove_if(activeProxies.begin(), activeProxies.end(), [this, start](int other) {
+                    return proxies[other].max[0] <= start;
+                }), activeProxies.end());
+                for (auto other: activeProxies) {
+                    if (Overlap(endpoint.proxy, other)) {
+                        overlappingPairs.insert(GetPairKey(endpoint.proxy, other));
+                    }
+                }
+                activeProxies.push_back(endpoint.proxy);
+            }
+        }
+
+        void SortAxis(int axis) {
+            auto& axisEndpoints = endpoints[axis];
+            UpdateEndpoints(axis);
+
+            for (unsigned int i = 1; i < axisEndpoints.size(); i++) {
+                const Endpoint endpoint = axisEndpoints[i];
+                int j = i;
+                while (j > 0 && endpoint < axisEndpoints[j - 1]) {
+                    const Endpoint& passed = axisEndpoints[j - 1];
+                    if (endpoint.proxy == passed.proxy) {
+                        // The two ends of a box with no size swapping places
+                    } else if (endpoint.isMin && !passed.isMin) {
+                        // A min moving before the other max: the boxes start overlapping on this axis
+                        if (Overlap(endpoint.proxy, passed.proxy)) {
+                            overlappingPairs.insert(GetPairKey(endpoint.proxy, passed.proxy));
+                        }
+                    } else if (!endpoint.isMin && passed.isMin) {
+                        // A max moving before the other min: the boxes stop overlapping on this axis
+                        overlappingPairs.erase(GetPairKey(endpoint.proxy, passed.proxy));
+                    }
+                    axisEndpoints[j] = passed;
+                    j--;
+                }
+                axisEndpoints[j] = endpoint;
+            }
+        }
+
+    public:
+        // Updates the boxes of this frame and writes the pairs (i, j), i < j, of boxes that overlap and whose layers
+        // interact (layerMasks[i] has the bit of layerBits[j]), sorted by i and then j
+        void FindPairs(const int* ids, const float* minX, const float* minY, const float* maxX, const float* maxY, const uint32_t* layerBits, const uint32_t* layerMasks, int count, std::vector<std::pair<int, int>>& pairs) {
+            frame++;
+            int numNewProxies = 0;
+            for (int box = 0; box < count; box++) {
+                if (layerMasks[box] == 0) {
+                    continue;
+                }
+                const int id = ids[box];
+                int proxy = id < static_cast<int>(proxyOfId.size()) ? proxyOfId[id] : -1;
+                if (proxy != -1 && (proxies[proxy].layerBits != layerBits[box] || proxies[proxy].layerMask != layerMasks[box])) {
+                    // The pairs of the box depend on its layer, start over with a new proxy (the old one is removed as stale)
+                    proxy = -1;
+                }
+                if (proxy == -1) {
+                    proxy = CreateProxy(id);
+                    numNewProxies++;
+                }
+                Proxy& boxProxy = proxies[proxy];
+                boxProxy.min[0] = minX[box];
+                boxProxy.min[1] = minY[box];
+                boxProxy.max[0] = maxX[box];
+                boxProxy.max[1] = maxY[box];
+                boxProxy.layerBits = layerBits[box];
+                boxProxy.layerMask = layerMasks[box];
+                boxProxy.box = box;
+                boxProxy.lastFrame = frame;
+            }
+            RemoveStaleProxies();
+
+            // Moving a new endpoint into place can cross the whole list, so with many new boxes (like in the first frame) it's faster to start over
+            if (numNewProxies > 64 && numNewProxies * 8 > count) {
+                Rebuild();
+            } else {
+                SortAxis(0);
+                SortAxis(1);
+            }
+
+            pairs.clear();
+            for (auto key: overlappingPairs) {
+                const int a = proxies[key >> 32].box;
+                const int b = proxies[key & 0xFFFFFFFF].box;
+                pairs.emplace_back(std::min(a, b), std::max(a, b));
+            }
+            std::sort(pairs.begin(), pairs.end());
+        }
+};
+
+#endif
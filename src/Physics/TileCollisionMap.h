@@ -0,0 +1,200 @@
+#ifndef TILECOLLISIONMAP_H
+#define TILECOLLISIONMAP_H
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include "./AABB.h"
+#include "./CollisionLayers.h"
+
+// What a map tile is made of, for collisions
+enum class TileClass: uint8_t {
+    Empty,
+    // Walls, rocks, buildings
+    Solid,
+    Water,
+    // Invisible barriers (e.g. the edges of the map)
+    Blocked
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// TileCollisionMap
+///////////////////////////////////////////////////////////////////////////////
+// The collision class of every tile of the map in a flat grid (one byte per
+// tile, 16 MB for a 4096x4096 map), so terrain collides without any collider
+// entities. Each collision layer has a mask of the tile classes that block
+// it, and boxes are tested and moved against the grid by looking only at the
+// tiles they touch. Tiles outside the map are Blocked.
+///////////////////////////////////////////////////////////////////////////////
+class TileCollisionMap {
+    private:
+        int numCols = 0;
+        int numRows = 0;
+        double tileSize = 1.0;
+        // Tile classes, row after row
+        std::vector<TileClass> tiles;
+        // Tile classes that block each collision layer, one bit per class
+        uint32_t blockingMasks[MAX_COLLISION_LAYERS];
+
+        // Columns (or rows) covered by a box from min to max on one axis
+        int GetFirstCell(double min) const {
+            return static_cast<int>(std::floor(min / tileSize));
+        }
+
+        int GetLastCell(double max) const {
+            return static_cast<int>(std::ceil(max / tileSize)) - 1;
+        }
+
+        // The first tile in the cells [firstCol, lastCol] x [firstRow, lastRow] whose class is in the mask, Empty if none is
+        TileClass FindTile(int firstCol, int lastCol, int firstRow, int lastRow, uint32_t classMask) const {
+            for (int row = firstRow; row <= lastRow; row++) {
+                for (int col = firstCol; col <= lastCol; col++) {
+                    const TileClass tileClass = GetTile(col, row);
+                    if (classMask & GetClassBit(tileClass)) {
+                        return tileClass;
+                    }
+                }
+            }
+            return TileClass::Empty;
+        }
+
+    public:
+        TileCollisionMap() {
+            for (unsigned int layer = 0; layer < MAX_COLLISION_LAYERS; layer++) {
+                blockingMasks[layer] = 0;
+            }
+        }
+
+        // Makes the map numCols x numRows tiles of tileSize pixels, all Empty
+        void Resize(int numCols, int numRows, double tileSize) {
+            this->numCols = numCols;
+            this->numRows = numRows;
+            this->tileSize = tileSize;
+            tiles.assign(static_cast<size_t>(numCols) * numRows, TileClass::Empty);
+        }
+
+        int GetNumCols() const {
+            return numCols;
+        }
+
+        int GetNumRows() const {
+            return numRows;
+        }
+
+        double GetTileSize() const {
+            return tileSize;
+        }
+
+        void SetTile(int col, int row, TileClass tileClass) {
+            tiles[static_cast<size_t>(row) * numCols + col] = tileClass;
+        }
+
+        TileClass GetTile(int col, int row) const {
+            if (col < 0 || row < 0 || col >= numCols || row >= numRows) {
+                return TileClass::Blocked;
+            }
+            return tiles[static_cast<size_t>(row) * numCols + col];
+        }
+
+        // Class of the tile under the point (in world coordinates)
+        TileClass GetTileAt(double x, double y) const {
+            return GetTile(GetFirstCell(x), GetFirstCell(y));
+        }
+
+        // Class written as the symbol in tile class files ('.' empty, '#' solid, '~' water, 'x' blocked), Empty for any other symbol
+        static TileClass GetClassOfSymbol(char symbol) {
+            switch (symbol) {
+                case '#': return TileClass::Solid;
+                case '~': return TileClass::Water;
+                case 'x': return TileClass::Blocked;
+                default: return TileClass::Empty;
+            }
+        }
+
+        static uint32_t GetClassBit(TileClass tileClass) {
+            return uint32_t(1) << static_cast<unsigned int>(tileClass);
+        }
+
+        // Whether tiles of the class stop colliders of the layer (no tile blocks any layer by default)
+        void SetBlocking(CollisionLayer layer, TileClass tileClass, bool isBlocking) {
+            if (isBlocking) {
+                blockingMasks[static_cast<unsigned int>(layer)] |= GetClassBit(tileClass);
+            } else {
+                blockingMasks[static_cast<unsigned int>(layer)] &= ~GetClassBit(tileClass);
+            }
+        }
+
+        // Tile classes that block the layer, one bit per class
+        uint32_t GetBlockingMask(CollisionLayer layer) const {
+            return blockingMasks[static_cast<unsigned int>(layer)];
+        }
+
+        // The first tile overlapped by the box whose class is in the mask, Empty if none is
+        TileClass FindOverlappingTile(const AABB& box, uint32_t classMask) const {
+            return FindTile(GetFirstCell(box.minX), GetLastCell(box.maxX), GetFirstCell(box.minY), GetLastCell(box.maxY), classMask);
+        }
+
+        ///////////////////////////////////////////////////////////////////////
+        // Moves the box by (dx, dy), first along x and then along y, and
+        // shortens the move on each axis so the box stops against the first
+        // tile in the mask it would enter. Only the tiles entered by the move
+        // are checked, so a box already overlapping a blocking tile can still
+        // move out of it. Returns the class of the tile that stopped the box,
+        // Empty if none did.
+        ///////////////////////////////////////////////////////////////////////
+        TileClass MoveBox(const AABB& box, double& dx, double& dy, uint32_t classMask) const {
+            TileClass hitClass = TileClass::Empty;
+            if (classMask == 0) {
+                return hitClass;
+            }
+
+            const int firstRow = GetFirstCell(box.minY);
+            const int lastRow = GetLastCell(box.maxY);
+            if (dx > 0.0) {
+                const int lastCol = GetLastCell(box.maxX + dx);
+                for (int col = GetLastCell(box.maxX) + 1; col <= lastCol; col++) {
+                    hitClass = FindTile(col, col, firstRow, lastRow, classMask);
+                    if (hitClass != TileClass::Empty) {
+                        dx = col * tileSize - box.maxX;
+                        break;
+                    }
+                }
+            } else if (dx < 0.0) {
+                const int lastCol = GetFirstCell(box.minX + dx);
+                for (int col = GetFirstCell(box.minX) - 1; col >= lastCol; col--) {
+                    hitClass = FindTile(col, col, firstRow, lastRow, classMask);
+                    if (hitClass != TileClass::Empty) {
+                        dx = (col + 1) * tileSize - box.minX;
+                        break;
+                    }
+                }
+            }
+
+            const int firstCol = GetFirstCell(box.minX + dx);
+            const int lastCol = GetLastCell(box.maxX + dx);
+            if (dy > 0.0) {
+                const int lastRow = GetLastCell(box.maxY + dy);
+                for (int row = GetLastCell(box.maxY) + 1; row <= lastRow; row++) {
+                    const TileClass rowHitClass = FindTile(firstCol, lastCol, row, row, classMask);
+                    if (rowHitClass != TileClass::Empty) {
+                        dy = row * tileSize - box.maxY;
+                        hitClass = rowHitClass;
+                        break;
+                    }
+                }
+            } else if (dy < 0.0) {
+                const int lastRow = GetFirstCell(box.minY + dy);
+                for (int row = GetFirstCell(box.minY) - 1; row >= lastRow; row--) {
+                    const TileClass rowHitClass = FindTile(firstCol, lastCol, row, row, classMask);
+                    if (rowHitClass != TileClass::Empty) {
+                        dy = (row + 1) * tileSize - box.minY;
+                        hitClass = rowHitClass;
+                        break;
+                    }
+                }
+            }
+            return hitClass;
+        }
+};
+
+#endif
@@ -1,21 +1,64 @@
 #ifndef POOL_H
 #define POOL_H
 
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <tuple>
+
 // Required to have a vector of pools containing different object types
 class IPool {
     public:
         virtual ~IPool() {}
+        virtual void RemoveEntityFromPool(int entityId) = 0;
 };
 
-// A pool is just a vector (contiguous data) of objects of type T
+///////////////////////////////////////////////////////////////////////////////
+// Pool
+///////////////////////////////////////////////////////////////////////////////
+// A pool is a sparse set of objects of type T. The objects are kept packed
+// (contiguous, without holes) in the data vector, and a paged sparse array
+// maps each entity id to the index of its object in the packed data. This
+// way memory grows with the number of components actually held and not with
+// the number of entities, and systems can iterate the packed data directly.
+///////////////////////////////////////////////////////////////////////////////
 template <typename T>
 class Pool: public IPool {
     private:
+        // Number of entity ids covered by each page of the sparse array
+        static constexpr int PAGE_SIZE = 4096;
+
+        // Packed objects and the entity id that owns each one (same index)
         std::vector<T> data;
-    
+        std::vector<int> entities;
+
+        // Pages of entity id -> packed index (-1 means the entity has no object)
+        std::vector<std::unique_ptr<int[]>> sparse;
+
+        int* GetSparseSlot(int entityId) const {
+            const int page = entityId / PAGE_SIZE;
+            if (page >= static_cast<int>(sparse.size()) || !sparse[page]) {
+                return nullptr;
+            }
+            return &sparse[page][entityId % PAGE_SIZE];
+        }
+
+        int& AccommodateSparseSlot(int entityId) {
+            const int page = entityId / PAGE_SIZE;
+            if (page >= static_cast<int>(sparse.size())) {
+                sparse.resize(page + 1);
+            }
+            if (!sparse[page]) {
+                sparse[page] = std::make_unique<int[]>(PAGE_SIZE);
+                std::fill(sparse[page].get(), sparse[page].get() + PAGE_SIZE, -1);
+            }
+            return sparse[page][entityId % PAGE_SIZE];
+        }
+
     public:
-        Pool(int size = 100) {
-            Resize(size);
+        Pool(int capacity = 100) {
+            data.reserve(capacity);
+            entities.reserve(capacity);
         }
 
         virtual ~Pool() = default;
@@ -28,24 +71,64 @@ class Pool: public IPool {
             return data.size();
         }
 
-        void Resize(int n) {
-            data.resize(n);
-        }
-
         void Clear() {
             data.clear();
+            entities.clear();
+            sparse.clear();
+        }
+
+        bool Has(int entityId) const {
+            const int* slot = GetSparseSlot(entityId);
+            return slot && *slot != -1;
+        }
+
+        void Set(int entityId, T object) {
+            int& index = AccommodateSparseSlot(entityId);
+            if (index != -1) {
+                // The entity already has an object, so we simply replace it
+                data[index] = std::move(object);
+                return;
+            }
+            index = data.size();
+            data.push_back(std::move(object));
+            entities.push_back(entityId);
         }
 
-        void Add(T object) {
-            data.push_back(object);
+        void Remove(int entityId) {
+            int* slot = GetSparseSlot(entityId);
+            if (!slot || *slot == -1) {
+                return;
+            }
+
+            // Move the last object into the removed position to keep the data packed
+            const int indexOfRemoved = *slot;
+            const int indexOfLast = data.size() - 1;
+            if (indexOfRemoved != indexOfLast) {
+                const int entityIdOfLast = entities[indexOfLast];
+                data[indexOfRemoved] = std::move(data[indexOfLast]);
+                entities[indexOfRemoved] = entityIdOfLast;
+                *GetSparseSlot(entityIdOfLast) = indexOfRemoved;
+            }
+            *slot = -1;
+            data.pop_back();
+            entities.pop_back();
+        }
+
+        void RemoveEntityFromPool(int entityId) override {
+            Remove(entityId);
         }
 
-        void Set(int index, T object) {
-            data[index] = object;
+        T& Get(int entityId) {
+            return data[*GetSparseSlot(entityId)];
         }
 
-        T& Get(int index) {
-            return static_cast<T&>(data[index]);
+        // Packed access, used to iterate all objects of the pool contiguously
+        T* GetData() {
+            return data.data();
+        }
+
+        const std::vector<int>& GetEntities() const {
+            return entities;
         }
 
         T& operator [](unsigned int index) {
@@ -53,4 +136,146 @@ class Pool: public IPool {
         }
 };
 
-#endif
\ No newline at end of file
+///////////////////////////////////////////////////////////////////////////////
+// PoolView
+///////////////////////////////////////////////////////////////////////////////
+// Iterates the entities that have objects in all the given pools, walking the
+// packed entity list of the smallest pool.
+///////////////////////////////////////////////////////////////////////////////
+template <typename ...TComponents>
+class PoolView {
+    private:
+        std::tuple<Pool<TComponents>*...> pools;
+
+        // Packed entity ids of the smallest pool, which drive the iteration
+        const int* entityIds = nullptr;
+        size_t numEntityIds = 0;
+
+        bool Matches(int entityId) const {
+            return (std::get<Pool<TComponents>*>(pools)->Has(entityId) && ...);
+        }
+
+    public:
+        PoolView(Pool<TComponents>* ...componentPools): pools(componentPools...) {
+            // The view is empty if any of the component types has no pool yet
+            if (((componentPools == nullptr) || ...)) {
+                return;
+            }
+            const std::vector<int>* candidates[] = { &componentPools->GetEntities()... };
+            const std::vector<int>* smallest = candidates[0];
+            for (auto candidate: candidates) {
+                if (candidate->size() < smallest->size()) {
+                    smallest = candidate;
+                }
+            }
+            entityIds = smallest->data();
+            numEntityIds = smallest->size();
+        }
+
+        class Iterator {
+            private:
+                const PoolView* view;
+                size_t index;
+
+                void SkipUnmatched() {
+                    while (index < view->numEntityIds && !view->Matches(view->entityIds[index])) {
+                        index++;
+                    }
+                }
+
+            public:
+                Iterator(const PoolView* view, size_t index): view(view), index(index) {
+                    SkipUnmatched();
+                }
+
+                int GetEntityId() const {
+                    return view->entityIds[index];
+                }
+
+                size_t GetPosition() const {
+                    return index;
+                }
+
+                template <typename T>
+                T& Get() const {
+                    return std::get<Pool<T>*>(view->pools)->Get(view->entityIds[index]);
+                }
+
+                Iterator& operator ++() {
+                    index++;
+                    SkipUnmatched();
+                    return *this;
+                }
+
+                bool operator ==(const Iterator& other) const { return index == other.index; }
+                bool operator !=(const Iterator& other) const { return index != other.index; }
+        };
+
+        Iterator begin() const { return Iterator(this, 0); }
+        Iterator end() const { return Iterator(this, numEntityIds); }
+
+        // Random access to split the iteration in chunks (positions go from 0 to GetSize())
+        size_t GetSize() const { return numEntityIds; }
+        Iterator At(size_t position) const { return Iterator(this, position); }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// PoolStorage
+///////////////////////////////////////////////////////////////////////////////
+// Component storage backend with one sparse-set pool per component type
+// (vector index = component id). This is the default registry layout.
+///////////////////////////////////////////////////////////////////////////////
+class PoolStorage {
+    private:
+        std::vector<std::shared_ptr<IPool>> componentPools;
+
+        template <typename T>
+        Pool<T>* GetPool(unsigned int componentId) const {
+            if (componentId >= componentPools.size()) {
+                return nullptr;
+            }
+            return static_cast<Pool<T>*>(componentPools[componentId].get());
+        }
+
+    public:
+        template <typename ...TComponents>
+        using ViewType = PoolView<TComponents...>;
+
+        template <typename T>
+        void Add(unsigned int componentId, int entityId, T component) {
+            if (componentId >= componentPools.size()) {
+                componentPools.resize(componentId + 1, nullptr);
+            }
+            if (!componentPools[componentId]) {
+                componentPools[componentId] = std::make_shared<Pool<T>>();
+            }
+            GetPool<T>(componentId)->Set(entityId, std::move(component));
+        }
+
+        template <typename T>
+        void Remove(unsigned int componentId, int entityId) {
+            GetPool<T>(componentId)->Remove(entityId);
+        }
+
+        template <typename T>
+        T& Get(unsigned int componentId, int entityId) const {
+            return GetPool<T>(componentId)->Get(entityId);
+        }
+
+        // Removes all objects of the entity, using its signature to only visit the pools it has data in
+        template <typename TSignature>
+        void RemoveEntity(int entityId, const TSignature& signature) {
+            for (unsigned int componentId = 0; componentId < componentPools.size(); componentId++) {
+                if (componentPools[componentId] && signature.test(componentId)) {
+                    componentPools[componentId]->RemoveEntityFromPool(entityId);
+                }
+            }
+        }
+
+        template <typename ...TComponents, typename ...TComponentIds>
+        PoolView<TComponents...> View(TComponentIds ...componentIds) const {
+            return PoolView<TComponents...>(GetPool<TComponents>(componentIds)...);
+        }
+};
+
+#endif
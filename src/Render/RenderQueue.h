@@ -0,0 +1,217 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <utility>
+#include <algorithm>
+#include <SDL2/SDL.h>
+
+// A sprite to draw
+struct DrawItem {
+    // Draw order (see RenderQueue::MakeKey)
+    uint64_t key = 0;
+    SDL_Texture* texture = nullptr;
+    SDL_Rect srcRect = { 0, 0, 0, 0 };
+    // Destination in world coordinates (screen coordinates for fixed sprites)
+    float x = 0.0f;
+    float y = 0.0f;
+    float width = 0.0f;
+    float height = 0.0f;
+    double rotation = 0.0;
+    bool isFixed = false;
+
+    bool operator ==(const DrawItem& other) const {
+        return (
+            key == other.key && texture == other.texture &&
+            srcRect.x == other.srcRect.x && srcRect.y == other.srcRect.y && srcRect.w == other.srcRect.w && srcRect.h == other.srcRect.h &&
+            x == other.x && y == other.y && width == other.width && height == other.height &&
+            rotation == other.rotation && isFixed == other.isFixed
+        );
+    }
+
+    bool operator !=(const DrawItem& other) const {
+        return !(*this == other);
+    }
+};
+
+// What changed in the queue in the last update
+struct RenderQueueCounters {
+    int numItems = 0;
+    // Items that were added or changed, and the ones of them that had to be sorted again (their key changed)
+    int numChanged = 0;
+    int numSorted = 0;
+    int numRemoved = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// RenderQueue
+///////////////////////////////////////////////////////////////////////////////
+// The sprites to draw, kept sorted by a 64-bit key from one frame to the next.
+// Every frame each entity submits its draw item between Begin and End: items
+// that didn't change are left alone, items that changed in place (same key)
+// are overwritten, and only the items whose key changed are radix sorted and
+// merged back into the queue, which also drops the items of the entities that
+// weren't submitted. A frame where nothing moved in the draw order doesn't
+// sort or copy anything, and once the buffers have grown to the scene size
+// updating the queue doesn't allocate.
+// Example: queue.Begin(); queue.Submit(entityId, item); ...; queue.End();
+///////////////////////////////////////////////////////////////////////////////
+class RenderQueue {
+    private:
+        struct Slot {
+            DrawItem item;
+            unsigned int lastFrame = 0;
+            // Position of the item in the queue, -1 if it isn't in it
+            int index = -1;
+        };
+
+        // Slots of the entities, by entity id
+        std::vector<Slot> slots;
+        // The queue, sorted by key, and the one being merged
+        std::vector<DrawItem> items;
+        std::vector<DrawItem> mergedItems;
+        // Items whose key changed in this update, and the scratch buffer to sort them
+        std::vector<DrawItem> movedItems;
+        std::vector<DrawItem> sortScratch;
+
+        unsigned int frame = 0;
+        int numSubmittedQueued = 0;
+        int numStale = 0;
+        RenderQueueCounters counters;
+
+        static int GetEntityId(uint64_t key) {
+            return key & 0xFFFFFF;
+        }
+
+        // Whether the item in the queue is still the item of its entity
+        bool IsCurrent(const DrawItem& item) const {
+            const Slot& slot = slots[GetEntityId(item.key)];
+            return slot.lastFrame == frame && slot.item.key == item.key;
+        }
+
+        // Sorts the items by key, one byte per pass (least significant first), skipping the bytes that all keys share
+        static void RadixSort(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch) {
+            if (items.size() < 2) {
+                return;
+            }
+            scratch.resize(items.size());
+            for (int shift = 0; shift < 64; shift += 8) {
+                size_t counts[256] = {};
+                for (const auto& item: items) {
+                    counts[(item.key >> shift) & 0xFF]++;
+                }
+                if (counts[(items[0].key >> shift) & 0xFF] == items.size()) {
+                    continue;
+                }
+                size_t offset = 0;
+                for (auto& count: counts) {
+                    const size_t bucketSize = count;
+                    count = offset;
+                    offset += bucketSize;
+                }
+                for (const auto& item: items) {
+                    scratch[counts[(item.key >> shift) & 0xFF]++] = item;
+                }
+                std::swap(items, scratch);
+            }
+        }
+
+    public:
+        ///////////////////////////////////////////////////////////////////////
+        // Draw order key: the layer (z-index, -128 to 127) in the top 8
+        // bits, then the texture (12 bits) so the sprites of a layer are
+        // drawn texture by texture, then the y of the bottom of the sprite
+        // (20 bits, +-524288 pixels) so lower sprites are drawn over higher
+        // ones, and the entity id (24 bits) so no two keys are equal and the
+        // order never depends on the order of the updates.
+        ///////////////////////////////////////////////////////////////////////
+        static uint64_t MakeKey(int layer, int textureIndex, float bottomY, int entityId) {
+            const uint64_t layerBits = std::clamp(layer + 128, 0, 0xFF);
+            const uint64_t textureBits = std::clamp(textureIndex, 0, 0xFFF);
+            const uint64_t yBits = std::clamp(static_cast<int>(std::floor(bottomY)) + (1 << 19), 0, 0xFFFFF);
+            return layerBits << 56 | textureBits << 44 | yBits << 24 | (static_cast<uint64_t>(entityId) & 0xFFFFFF);
+        }
+
+        void Begin() {
+            frame++;
+            numSubmittedQueued = 0;
+            numStale = 0;
+            movedItems.clear();
+            counters = RenderQueueCounters();
+        }
+
+        // Sets the item of the entity for this frame (its key must come from MakeKey with the entity id)
+        void Submit(int entityId, const DrawItem& item) {
+            if (entityId >= static_cast<int>(slots.size())) {
+                slots.resize(entityId + 1);
+            }
+            Slot& slot = slots[entityId];
+            slot.lastFrame = frame;
+            if (slot.index != -1) {
+                numSubmittedQueued++;
+                if (slot.item == item) {
+                    return;
+                }
+                counters.numChanged++;
+                if (slot.item.key == item.key) {
+                    // Same place in the draw order
+                    slot.item = item;
+                    items[slot.index] = item;
+                    return;
+                }
+                // The old item is left in the queue until the merge drops it
+                numStale++;
+            } else {
+                counters.numChanged++;
+            }
+            slot.item = item;
+            movedItems.push_back(item);
+        }
+
+        // Sorts the items whose key changed and merges them into the queue
+        void End() {
+            // The items of the entities that weren't submitted are gone
+            const int numRemoved = items.size() - numSubmittedQueued;
+            numStale += numRemoved;
+            counters.numRemoved = numRemoved;
+            counters.numSorted = movedItems.size();
+            if (numStale == 0 && movedItems.empty()) {
+                counters.numItems = items.size();
+                return;
+            }
+
+            RadixSort(movedItems, sortScratch);
+            mergedItems.clear();
+            size_t current = 0;
+            size_t moved = 0;
+            while (current < items.size() || moved < movedItems.size()) {
+                if (current < items.size() && !IsCurrent(items[current])) {
+                    Slot& slot = slots[GetEntityId(items[current].key)];
+                    if (slot.lastFrame != frame) {
+                        slot.index = -1;
+                    }
+                    current++;
+                    continue;
+                }
+                const bool isMoved = current == items.size() || (moved < movedItems.size() && movedItems[moved].key < items[current].key);
+                const DrawItem& item = isMoved ? movedItems[moved++] : items[current++];
+                slots[GetEntityId(item.key)].index = mergedItems.size();
+                mergedItems.push_back(item);
+            }
+            std::swap(items, mergedItems);
+            counters.numItems = items.size();
+        }
+
+        // The items of the last update, in draw order
+        const std::vector<DrawItem>& GetItems() const {
+            return items;
+        }
+
+        const RenderQueueCounters& GetCounters() const {
+            return counters;
+        }
+};
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef SPRITEBINS_H
+#define SPRITEBINS_H
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+#include "../ECS/ECS.h"
+#include "../Physics/AABB.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// SpriteBins
+///////////////////////////////////////////////////////////////////////////////
+// Buckets sprite entities into coarse square bins of world space by the top
+// left corner of their sprite, and keeps them there from one frame to the
+// next: entities are only touched when they are added, removed, or move to
+// another bin. Finding the sprites in a rectangle walks only the bins that
+// overlap it (grown by the size of the largest sprite, which may reach into
+// the rectangle from a bin on its left or top), so the cost follows what is
+// on screen and not the size of the world.
+///////////////////////////////////////////////////////////////////////////////
+class SpriteBins {
+    private:
+        struct Location {
+            uint64_t bin = 0;
+            // Position in the bin, -1 if the entity isn't in any bin
+            int index = -1;
+        };
+
+        double binSize;
+        std::unordered_map<uint64_t, std::vector<Entity>> bins;
+        std::vector<Location> locationOfEntity;
+
+        // Largest sprite width or height seen, the rectangle of the queries is grown by it
+        double maxSpriteSize = 0.0;
+
+        int GetBinCoordinate(double position) const {
+            return static_cast<int>(std::floor(position / binSize));
+        }
+
+        static uint64_t GetBin(int binX, int binY) {
+            return static_cast<uint64_t>(static_cast<uint32_t>(binX)) << 32 | static_cast<uint32_t>(binY);
+        }
+
+        uint64_t GetBin(const AABB& bounds) const {
+            return GetBin(GetBinCoordinate(bounds.minX), GetBinCoordinate(bounds.minY));
+        }
+
+        void GrowMaxSpriteSize(const AABB& bounds) {
+            maxSpriteSize = std::max({ maxSpriteSize, bounds.maxX - bounds.minX, bounds.maxY - bounds.minY });
+        }
+
+        void AddToBin(Entity entity, uint64_t bin) {
+            std::vector<Entity>& entities = bins[bin];
+            Location& location = locationOfEntity[entity.GetId()];
+            location.bin = bin;
+            location.index = entities.size();
+            entities.push_back(entity);
+        }
+
+        void RemoveFromBin(Entity entity) {
+            Location& location = locationOfEntity[entity.GetId()];
+            std::vector<Entity>& entities = bins[location.bin];
+            // Swap the removed entity with the last one of the bin and pop it
+            const Entity last = entities.back();
+            entities[location.index] = last;
+            locationOfEntity[last.GetId()].index = location.index;
+            entities.pop_back();
+            location.index = -1;
+        }
+
+    public:
+        SpriteBins(double binSize = 256.0): binSize(binSize) {}
+
+        bool Contains(Entity entity) const {
+            return entity.GetId() < static_cast<int>(locationOfEntity.size()) && locationOfEntity[entity.GetId()].index != -1;
+        }
+
+        // Puts the entity in the bin of the top left corner of the bounds of its sprite
+        void Insert(Entity entity, const AABB& bounds) {
+            if (entity.GetId() >= static_cast<int>(locationOfEntity.size())) {
+                locationOfEntity.resize(entity.GetId() + 1);
+            }
+            GrowMaxSpriteSize(bounds);
+            AddToBin(entity, GetBin(bounds));
+        }
+
+        // Moves the entity to the bin of the new bounds of its sprite if it isn't in it already
+        void Move(Entity entity, const AABB& bounds) {
+            GrowMaxSpriteSize(bounds);
+            const uint64_t bin = GetBin(bounds);
+            if (locationOfEntity[entity.GetId()].bin != bin) {
+                RemoveFromBin(entity);
+                AddToBin(entity, bin);
+            }
+        }
+
+        void Remove(Entity entity) {
+            if (Contains(entity)) {
+                RemoveFromBin(entity);
+            }
+        }
+
+        // Calls callback(entity) for the entities whose sprite may overlap the rectangle (the caller tests them exactly)
+        template <typename TCallback>
+        void Query(const AABB& rect, TCallback callback) const {
+            const int firstBinX = GetBinCoordinate(rect.minX - maxSpriteSize);
+            const int firstBinY = GetBinCoordinate(rect.minY - maxSpriteSize);
+            const int lastBinX = GetBinCoordinate(rect.maxX);
+            const int lastBinY = GetBinCoordinate(rect.maxY);
+            for (int binY = firstBinY; binY <= lastBinY; binY++) {
+                for (int binX = firstBinX; binX <= lastBinX; binX++) {
+                    const auto bin = bins.find(GetBin(binX, binY));
+                    if (bin == bins.end()) {
+                        continue;
+                    }
+                    for (auto entity: bin->second) {
+                        callback(entity);
+                    }
+                }
+            }
+        }
+};
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef TILELAYER_H
+#define TILELAYER_H
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <SDL2/SDL.h>
+#include "../AssetStore/AssetStore.h"
+
+// What the tile layer drew in the last render
+struct TileLayerCounters {
+    // Chunks drawn (overlapping the camera), and the ones of them that had to be baked again first
+    int numVisibleChunks = 0;
+    int numBakedChunks = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// TileLayer
+///////////////////////////////////////////////////////////////////////////////
+// The tiles of the map, drawn under all sprites. The map is split in square
+// chunks of about 512x512 pixels, and each chunk is baked once into a render
+// target texture with all its tiles. Rendering then copies only the few
+// chunks that overlap the camera, one draw call each, instead of drawing
+// every tile, and a chunk is baked again only when a tile in it changes.
+// Chunk textures are made the first time their chunk is seen. If the
+// renderer can't render to textures, the tiles of the visible chunks are
+// drawn one by one instead.
+///////////////////////////////////////////////////////////////////////////////
+class TileLayer {
+    private:
+        struct Chunk {
+            SDL_Texture* texture = nullptr;
+            bool isBaked = false;
+        };
+
+        int numCols = 0;
+        int numRows = 0;
+        // Size of a tile in the tileset, and on screen
+        int tileSize = 0;
+        double scale = 1.0;
+        TextureHandle tileset;
+        // Position of each tile in the tileset (row after row), x = -1 for no tile
+        std::vector<SDL_Point> tiles;
+
+        int chunkSize;
+        int tilesPerChunk = 1;
+        int numChunkCols = 0;
+        int numChunkRows = 0;
+        std::vector<Chunk> chunks;
+        // Whether the renderer failed to make a chunk texture, the tiles are drawn one by one then
+        bool isBakingUnsupported = false;
+
+        TileLayerCounters counters;
+
+        double GetScaledTileSize() const {
+            return tileSize * scale;
+        }
+
+        // Draws the tiles of the chunk, offset by (-offsetX, -offsetY) from their world position
+        void DrawChunkTiles(SDL_Renderer* renderer, const TextureRegion& region, int chunkCol, int chunkRow, int offsetX, int offsetY) const {
+            const int firstCol = chunkCol * tilesPerChunk;
+            const int firstRow = chunkRow * tilesPerChunk;
+            const int lastCol = std::min(firstCol + tilesPerChunk, numCols) - 1;
+            const int lastRow = std::min(firstRow + tilesPerChunk, numRows) - 1;
+            for (int row = firstRow; row <= lastRow; row++) {
+                for (int col = firstCol; col <= lastCol; col++) {
+                    const SDL_Point& tile = tiles[static_cast<size_t>(row) * numCols + col];
+                    if (tile.x == -1) {
+                        continue;
+                    }
+                    const SDL_Rect srcRect = { region.rect.x + tile.x, region.rect.y + tile.y, tileSize, tileSize };
+                    const SDL_Rect dstRect = {
+                        static_cast<int>(col * GetScaledTileSize()) - offsetX,
+                        static_cast<int>(row * GetScaledTileSize()) - offsetY,
+                        static_cast<int>(GetScaledTileSize()),
+                        static_cast<int>(GetScaledTileSize())
+                    };
+                    SDL_RenderCopy(renderer, region.texture, &srcRect, &dstRect);
+                }
+            }
+        }
+
+        // World rectangle of the chunk, cut at the edges of the map
+        SDL_Rect GetChunkRect(int chunkCol, int chunkRow) const {
+            const int x = static_cast<int>(chunkCol * tilesPerChunk * GetScaledTileSize());
+            const int y = static_cast<int>(chunkRow * tilesPerChunk * GetScaledTileSize());
+            const int maxX = static_cast<int>(std::min((chunkCol + 1) * tilesPerChunk, numCols) * GetScaledTileSize());
+            const int maxY = static_cast<int>(std::min((chunkRow + 1) * tilesPerChunk, numRows) * GetScaledTileSize());
+            return { x, y, maxX - x, maxY - y };
+        }
+
+        // Draws the tiles of the chunk into its texture, making the texture the first time; false if the renderer can't
+        bool BakeChunk(SDL_Renderer* renderer, const TextureRegion& region, int chunkCol, int chunkRow) {
+            Chunk& chunk = chunks[static_cast<size_t>(chunkRow) * numChunkCols + chunkCol];
+            const SDL_Rect chunkRect = GetChunkRect(chunkCol, chunkRow);
+            if (!chunk.texture) {
+                chunk.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, chunkRect.w, chunkRect.h);
+                if (!chunk.texture) {
+                    return false;
+                }
+                SDL_SetTextureBlendMode(chunk.texture, SDL_BLENDMODE_BLEND);
+            }
+
+            SDL_Texture* previousTarget = SDL_GetRenderTarget(renderer);
+            if (SDL_SetRenderTarget(renderer, chunk.texture) != 0) {
+                SDL_DestroyTexture(chunk.texture);
+                chunk.texture = nullptr;
+                return false;
+            }
+            // Clear to transparent, the places without a tile show what is under the layer
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+            SDL_RenderClear(renderer);
+            DrawChunkTiles(renderer, region, chunkCol, chunkRow, chunkRect.x, chunkRect.y);
+            SDL_SetRenderTarget(renderer, previousTarget);
+            chunk.isBaked = true;
+            counters.numBakedChunks++;
+            return true;
+        }
+
+    public:
+        // Chunks are the whole tiles that fit in chunkSize x chunkSize pixels (on screen)
+        TileLayer(int chunkSize = 512): chunkSize(chunkSize) {}
+
+        ~TileLayer() {
+            ClearChunks();
+        }
+
+        TileLayer(const TileLayer&) = delete;
+        TileLayer& operator =(const TileLayer&) = delete;
+
+        // Makes the layer numCols x numRows tiles of the tileset, tileSize pixels in it and drawn scaled, all empty
+        void Resize(int numCols, int numRows, int tileSize, double scale, TextureHandle tileset) {
+            ClearChunks();
+            this->numCols = numCols;
+            this->numRows = numRows;
+            this->tileSize = tileSize;
+            this->scale = scale;
+            this->tileset = tileset;
+            tiles.assign(static_cast<size_t>(numCols) * numRows, { -1, -1 });
+            tilesPerChunk = std::max(1, static_cast<int>(chunkSize / GetScaledTileSize()));
+            numChunkCols = (numCols + tilesPerChunk - 1) / tilesPerChunk;
+            numChunkRows = (numRows + tilesPerChunk - 1) / tilesPerChunk;
+            chunks.assign(static_cast<size_t>(numChunkCols) * numChunkRows, Chunk());
+        }
+
+        // Sets the tile to the one at (srcX, srcY) in the tileset, its chunk is baked again when it is next seen
+        void SetTile(int col, int row, int srcX, int srcY) {
+            SDL_Point& tile = tiles[static_cast<size_t>(row) * numCols + col];
+            if (tile.x == srcX && tile.y == srcY) {
+                return;
+            }
+            tile = { srcX, srcY };
+            chunks[static_cast<size_t>(row / tilesPerChunk) * numChunkCols + col / tilesPerChunk].isBaked = false;
+        }
+
+        // Destroys the chunk textures (e.g. before the renderer, or on SDL_RENDER_TARGETS_RESET when the renderer lost their
+        // pixels), they are made and baked again when needed
+        void ClearChunks() {
+            for (auto& chunk: chunks) {
+                if (chunk.texture) {
+                    SDL_DestroyTexture(chunk.texture);
+                }
+                chunk = Chunk();
+            }
+        }
+
+        // Draws the chunks that overlap the camera, baking the ones whose tiles changed
+        void Render(SDL_Renderer* renderer, std::unique_ptr<AssetStore>& assetStore, const SDL_Rect& camera) {
+            counters = TileLayerCounters();
+            const TextureRegion* region = assetStore->GetTextureRegion(tileset);
+            if (!region || numChunkCols == 0 || numChunkRows == 0) {
+                return;
+            }
+
+            const double chunkWorldSize = tilesPerChunk * GetScaledTileSize();
+            const int firstChunkCol = std::max(0, static_cast<int>(camera.x / chunkWorldSize));
+            const int firstChunkRow = std::max(0, static_cast<int>(camera.y / chunkWorldSize));
+            const int lastChunkCol = std::min(numChunkCols - 1, static_cast<int>((camera.x + camera.w) / chunkWorldSize));
+            const int lastChunkRow = std::min(numChunkRows - 1, static_cast<int>((camera.y + camera.h) / chunkWorldSize));
+            for (int chunkRow = firstChunkRow; chunkRow <= lastChunkRow; chunkRow++) {
+                for (int chunkCol = firstChunkCol; chunkCol <= lastChunkCol; chunkCol++) {
+                    const Chunk& chunk = chunks[static_cast<size_t>(chunkRow) * numChunkCols + chunkCol];
+                    if (!isBakingUnsupported && !chunk.isBaked && !BakeChunk(renderer, *region, chunkCol, chunkRow)) {
+                        isBakingUnsupported = true;
+                    }
+                    if (isBakingUnsupported) {
+                        DrawChunkTiles(renderer, *region, chunkCol, chunkRow, camera.x, camera.y);
+                    } else {
+                        const SDL_Rect chunkRect = GetChunkRect(chunkCol, chunkRow);
+                        const SDL_Rect dstRect = { chunkRect.x - camera.x, chunkRect.y - camera.y, chunkRect.w, chunkRect.h };
+                        SDL_RenderCopy(renderer, chunk.texture, NULL, &dstRect);
+                    }
+                    counters.numVisibleChunks++;
+                }
+            }
+        }
+
+        const TileLayerCounters& GetCounters() const {
+            return counters;
+        }
+};
+
+#endif
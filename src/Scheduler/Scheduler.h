@@ -0,0 +1,164 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include "../ECS/ECS.h"
+#include "./ThreadPool.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// SchedulerReport
+///////////////////////////////////////////////////////////////////////////////
+// Wall-clock time the systems took in the last frame run in parallel, and in
+// the last frame run one system after the other (the scheduler runs one every
+// SERIAL_FRAME_INTERVAL frames to measure it, all of them without workers).
+// The task times of a parallel frame can't give the serial time: tasks that
+// run at the same time slow each other down, so their sum overstates it.
+///////////////////////////////////////////////////////////////////////////////
+struct SchedulerReport {
+    double parallelMilliseconds = 0.0;
+    double serialMilliseconds = 0.0;
+
+    double GetSavedMilliseconds() const {
+        return serialMilliseconds - parallelMilliseconds;
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Scheduler
+///////////////////////////////////////////////////////////////////////////////
+// The scheduler updates the systems every frame, running the ones that don't
+// conflict (based on the components and entity changes each system declares)
+// at the same time in a pool of worker threads. Systems that do conflict keep
+// the order in which they were added to the scheduler. Every
+// SERIAL_FRAME_INTERVAL frames the systems run one after the other instead,
+// to time the frame without the parallelism.
+// Example: scheduler->AddSystem(movementSystem, [&](double deltaTime) { movementSystem.Update(registry, deltaTime); });
+///////////////////////////////////////////////////////////////////////////////
+class Scheduler {
+    private:
+        // Number of frames between the frames run one system after the other (starting with the first one)
+        static constexpr int SERIAL_FRAME_INTERVAL = 120;
+
+        struct Task {
+            System* system;
+            std::function<void(double)> update;
+
+            // Tasks that must wait for this one, and how many tasks this one waits for
+            std::vector<int> successors;
+            int numPredecessors = 0;
+        };
+
+        std::vector<Task> tasks;
+        bool isGraphBuilt = false;
+        int numFrames = 0;
+
+        // Per-frame counters of predecessors that still have to finish (index = task index)
+        std::unique_ptr<std::atomic<int>[]> remainingPredecessors;
+        std::atomic<int> numPendingTasks{0};
+        std::mutex mutex;
+        std::condition_variable frameFinished;
+
+        ThreadPool threadPool;
+        SchedulerReport lastReport;
+
+        // Builds the dependency graph once: a task depends on every earlier task it conflicts with
+        void BuildGraph() {
+            for (unsigned int j = 0; j < tasks.size(); j++) {
+                for (unsigned int i = 0; i < j; i++) {
+                    if (tasks[i].system->ConflictsWith(*tasks[j].system)) {
+                        tasks[i].successors.push_back(j);
+                        tasks[j].numPredecessors++;
+                    }
+                }
+            }
+            remainingPredecessors = std::make_unique<std::atomic<int>[]>(tasks.size());
+            isGraphBuilt = true;
+        }
+
+        void ExecuteTask(int index, double deltaTime) {
+            Task& task = tasks[index];
+            System::SetRunningSystem(task.system);
+            task.update(deltaTime);
+            System::SetRunningSystem(nullptr);
+        }
+
+        // Executes the task in a worker thread and submits the tasks that were waiting for it
+        void RunTask(int index, double deltaTime) {
+            ExecuteTask(index, deltaTime);
+
+            const Task& task = tasks[index];
+            for (auto successor: task.successors) {
+                if (--remainingPredecessors[successor] == 0) {
+                    threadPool.Submit([this, successor, deltaTime]() { RunTask(successor, deltaTime); });
+                }
+            }
+
+            if (--numPendingTasks == 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                frameFinished.notify_one();
+            }
+        }
+
+    public:
+        Scheduler(int numThreads = std::thread::hardware_concurrency()): threadPool(numThreads > 1 ? numThreads : 0) {}
+
+        void AddSystem(System& system, std::function<void(double)> update) {
+            Task task;
+            task.system = &system;
+            task.update = std::move(update);
+            tasks.push_back(std::move(task));
+            isGraphBuilt = false;
+        }
+
+        void Run(double deltaTime) {
+            if (!isGraphBuilt) {
+                BuildGraph();
+            }
+
+            const auto startTime = std::chrono::steady_clock::now();
+
+            const bool isSerial = threadPool.GetNumThreads() == 0 || numFrames++ % SERIAL_FRAME_INTERVAL == 0;
+            if (isSerial) {
+                // The systems run in the order they were added, which keeps the order of the conflicting ones
+                for (unsigned int i = 0; i < tasks.size(); i++) {
+                    ExecuteTask(i, deltaTime);
+                }
+            } else {
+                numPendingTasks = tasks.size();
+                for (unsigned int i = 0; i < tasks.size(); i++) {
+                    remainingPredecessors[i] = tasks[i].numPredecessors;
+                }
+                for (unsigned int i = 0; i < tasks.size(); i++) {
+                    if (tasks[i].numPredecessors == 0) {
+                        threadPool.Submit([this, i, deltaTime]() { RunTask(i, deltaTime); });
+                    }
+                }
+                std::unique_lock<std::mutex> lock(mutex);
+                frameFinished.wait(lock, [this]() { return numPendingTasks == 0; });
+            }
+
+            const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+            if (isSerial) {
+                lastReport.serialMilliseconds = milliseconds;
+            }
+            if (!isSerial || threadPool.GetNumThreads() == 0) {
+                lastReport.parallelMilliseconds = milliseconds;
+            }
+        }
+
+        ThreadPool& GetThreadPool() {
+            return threadPool;
+        }
+
+        const SchedulerReport& GetLastReport() const {
+            return lastReport;
+        }
+};
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////////
+// ThreadPool
+///////////////////////////////////////////////////////////////////////////////
+// A fixed set of worker threads that pick tasks from a shared queue.
+// Example: threadPool.Submit([]() { ... });
+///////////////////////////////////////////////////////////////////////////////
+class ThreadPool {
+    private:
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable taskAvailable;
+        bool isStopping = false;
+
+        void WorkerLoop() {
+            while (true) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    taskAvailable.wait(lock, [this]() { return isStopping || !tasks.empty(); });
+                    if (isStopping && tasks.empty()) {
+                        return;
+                    }
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                }
+                task();
+            }
+        }
+
+    public:
+        ThreadPool(int numThreads) {
+            for (int i = 0; i < numThreads; i++) {
+                workers.emplace_back(&ThreadPool::WorkerLoop, this);
+            }
+        }
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                isStopping = true;
+            }
+            taskAvailable.notify_all();
+            for (auto& worker: workers) {
+                worker.join();
+            }
+        }
+
+        int GetNumThreads() const {
+            return workers.size();
+        }
+
+        void Submit(std::function<void()> task) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.push_back(std::move(task));
+            }
+            taskAvailable.notify_one();
+        }
+
+        ///////////////////////////////////////////////////////////////////////
+        // Run the body once for each chunk index in [0, numChunks).
+        // Chunks are claimed one at a time from a shared counter, so idle
+        // workers keep stealing the remaining chunks from busy ones. The
+        // calling thread also works on chunks, which makes it safe to call
+        // from inside a task that is already running in the pool.
+        ///////////////////////////////////////////////////////////////////////
+        void ParallelFor(int numChunks, const std::function<void(int)>& body) {
+            struct Job {
+                std::atomic<int> nextChunk{0};
+                std::atomic<int> numFinishedChunks{0};
+                int numChunks;
+                const std::function<void(int)>* body;
+                std::mutex mutex;
+                std::condition_variable finished;
+            };
+            auto job = std::make_shared<Job>();
+            job->numChunks = numChunks;
+            job->body = &body;
+
+            auto work = [job]() {
+                int chunk;
+                while ((chunk = job->nextChunk++) < job->numChunks) {
+                    (*job->body)(chunk);
+                    if (++job->numFinishedChunks == job->numChunks) {
+                        std::lock_guard<std::mutex> lock(job->mutex);
+                        job->finished.notify_all();
+                    }
+                }
+            };
+
+            const int numHelpers = std::min<int>(workers.size(), numChunks - 1);
+            for (int i = 0; i < numHelpers; i++) {
+                Submit(work);
+            }
+            work();
+
+            std::unique_lock<std::mutex> lock(job->mutex);
+            job->finished.wait(lock, [&job]() { return job->numFinishedChunks == job->numChunks; });
+        }
+};
+
+#endif
@@ -12,6 +12,8 @@ class AnimationSystem: public System {
         AnimationSystem() {
             RequireComponent<AnimationComponent>();
             RequireComponent<SpriteComponent>();
+            WritesComponent<AnimationComponent>();
+            WritesComponent<SpriteComponent>();
         }
 
         void SubscribeToEvents(std::unique_ptr<EventBus>& eventBus) {
@@ -19,13 +21,11 @@ class AnimationSystem: public System {
         }
 
         void Update(std::unique_ptr<Registry>& registry) {
-            for (auto entity: GetSystemEntities()) {
-                AnimationComponent& animation = entity.GetComponent<AnimationComponent>();
-                SpriteComponent& sprite = entity.GetComponent<SpriteComponent>();
-                
-                animation.currentFrame = ((SDL_GetTicks() - animation.startTime) * animation.frameSpeedRate / 1000) % animation.numFrames;
+            const Uint32 ticks = SDL_GetTicks();
+            ParallelForEach<AnimationComponent, SpriteComponent>(*registry, [ticks](Entity entity, AnimationComponent& animation, SpriteComponent& sprite) {
+                animation.currentFrame = ((ticks - animation.startTime) * animation.frameSpeedRate / 1000) % animation.numFrames;
                 sprite.srcRect.x = animation.currentFrame * sprite.width;
-            }
+            });
         }
 };
 
@@ -13,6 +13,8 @@ class CameraMovementSystem: public System {
             RequireComponent<CameraFollowComponent>();
             RequireComponent<TransformComponent>();
             RequireComponent<SpriteComponent>();
+            ReadsComponent<CameraFollowComponent>();
+            ReadsComponent<TransformComponent>();
         }
 
         void SubscribeToEvents(std::unique_ptr<EventBus>& eventBus) {
@@ -22,7 +24,6 @@ class CameraMovementSystem: public System {
         void Update(std::unique_ptr<Registry>& registry, SDL_Rect& camera) {
             for (auto entity: GetSystemEntities()) {
                 const TransformComponent transform = entity.GetComponent<TransformComponent>();
-                const SpriteComponent sprite = entity.GetComponent<SpriteComponent>();
                 
                 // Change the camera to follow the entity that has a CameraFollow component attached to it
                 if (entity.HasComponent<CameraFollowComponent>()) {
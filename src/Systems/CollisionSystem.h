@@ -1,69 +1,640 @@
 #ifndef COLLISIONSYSTEM_H
 #define COLLISIONSYSTEM_H
 
-#include <iostream>
-
+#include <cmath>
+#include <algorithm>
+#include <limits>
 #include "../ECS/ECS.h"
 #include "../EventBus/EventBus.h"
 #include "../Components/TransformComponent.h"
 #include "../Components/BoxColliderComponent.h"
-#include "../Events/CollisionEvent.h"
+#include "../Components/RigidBodyComponent.h"
+#include "../Events/CollisionBeginEvent.h"
+#include "../Events/CollisionStayEvent.h"
+#include "../Events/CollisionEndEvent.h"
+#include "../Events/TileCollisionEvent.h"
+#include "../Logger/Logger.h"
+#include "../Physics/SpatialHashGrid.h"
+#include "../Physics/SweepAndPrune.h"
+#include "../Physics/ColliderTrees.h"
+#include "../Physics/AABBBatch.h"
+#include "../Physics/TileCollisionMap.h"
+
+// Algorithm used to find the pairs of colliders that may be colliding
+enum class Broadphase {
+    BruteForce,
+    SpatialHash,
+    // Best when most colliders are static or move slowly (the work follows how much the boxes move)
+    SweepAndPrune,
+    // Static colliders (no rigid body) and dynamic ones in separate trees, also used for queries (see GetColliderTrees)
+    AABBTree
+};
+
+// Candidate pairs tested by each chunk of the narrowphase, and colliders tested against all the others by each chunk of the brute force one
+const unsigned int NARROWPHASE_CHUNK_SIZE = 2048;
+const unsigned int BRUTE_FORCE_CHUNK_SIZE = 128;
+// Fast movers swept by each chunk
+const unsigned int SWEEP_CHUNK_SIZE = 64;
+
+// Contacts and contact changes of the last update
+struct ContactCounters {
+    int numContacts = 0;
+    int numBegins = 0;
+    int numEnds = 0;
+    // Contacts found only by sweeping fast movers along their move
+    int numSweptContacts = 0;
+    // Colliders stopped by map tiles, and the ones of them that weren't stopped by a tile of that class in the last update
+    int numTileCollisions = 0;
+    int numTileBegins = 0;
+};
 
 class CollisionSystem: public System {
+    private:
+        Broadphase broadphase = Broadphase::AABBTree;
+        SpatialHashGrid spatialHashGrid;
+        SweepAndPrune sweepAndPrune;
+        ColliderTrees colliderTrees;
+
+        // Colliders of the current frame, in view order (index = collider index)
+        std::vector<Entity> colliderEntities;
+        std::vector<int> colliderEntityIds;
+        std::vector<uint8_t> colliderIsStatic;
+        std::vector<float> colliderMinX;
+        std::vector<float> colliderMinY;
+        std::vector<float> colliderMaxX;
+        std::vector<float> colliderMaxY;
+        std::vector<uint32_t> colliderLayerBits;
+        std::vector<uint32_t> colliderLayerMasks;
+        std::vector<float> colliderVelocityX;
+        std::vector<float> colliderVelocityY;
+        std::vector<uint8_t> colliderIsFastMover;
+        // Tile classes that block each collider (see TileCollisionMap::GetBlockingMask)
+        std::vector<uint32_t> colliderTileMasks;
+
+        // Colliders of fast movers, swept along their move, and the boxes they cover during it
+        std::vector<int> fastMovers;
+        std::vector<float> sweptMinX;
+        std::vector<float> sweptMinY;
+        std::vector<float> sweptMaxX;
+        std::vector<float> sweptMaxY;
+
+        // Which collision layers interact with which
+        CollisionMatrix collisionMatrix;
+
+        // Terrain of the map, if any
+        const TileCollisionMap* tileCollisionMap = nullptr;
+
+        // Pairs of colliders found by the broadphase (i < j), and the ones that really collide
+        std::vector<std::pair<int, int>> candidatePairs;
+        std::vector<std::pair<int, int>> collidingPairs;
+
+        // Pairs of entities touching in the last update and in this one (lower id << 32 | higher id), sorted
+        std::vector<uint64_t> previousContacts;
+        std::vector<uint64_t> contacts;
+        bool shouldEmitStayEvents = false;
+        ContactCounters contactCounters;
+
+        // Colliders stopped by a map tile in the last update and in this one (entity id << 8 | tile class), sorted
+        std::vector<uint64_t> previousTileContacts;
+        std::vector<uint64_t> tileContacts;
+
+        // Entities that left the system (killed, or lost a collider) since the last update; their ids may have been reused
+        // already, so their contacts of the last update are ended without touching their components
+        std::vector<int> removedEntityIds;
+
+        bool IsRemovedEntity(int entityId) const {
+            return std::binary_search(removedEntityIds.begin(), removedEntityIds.end(), entityId);
+        }
+
+        // Buffers of one chunk of the narrowphase: the candidates of one collider, the ones that overlap it, and the
+        // pairs that collide
+        struct NarrowphaseChunk {
+            std::vector<int> candidates;
+            std::vector<int> overlapping;
+            std::vector<std::pair<int, int>> pairs;
+        };
+        std::vector<NarrowphaseChunk> narrowphaseChunks;
+
+        // Runs the chunks (maybe in parallel) and appends their pairs to the colliding pairs, in chunk order, so the
+        // result is the same as running them one after the other
+        template <typename TFunction>
+        void RunNarrowphaseChunks(Registry& registry, int numChunks, TFunction function) {
+            if (static_cast<int>(narrowphaseChunks.size()) < numChunks) {
+                narrowphaseChunks.resize(numChunks);
+            }
+            registry.ParallelFor(numChunks, [&](int chunk) {
+                NarrowphaseChunk& buffers = narrowphaseChunks[chunk];
+                buffers.pairs.clear();
+                function(chunk, buffers);
+            });
+            for (int chunk = 0; chunk < numChunks; chunk++) {
+                const auto& pairs = narrowphaseChunks[chunk].pairs;
+                collidingPairs.insert(collidingPairs.end(), pairs.begin(), pairs.end());
+            }
+        }
+
+        void GatherColliders(Registry& registry) {
+            colliderEntities.clear();
+            colliderEntityIds.clear();
+            colliderIsStatic.clear();
+            colliderMinX.clear();
+            colliderMinY.clear();
+            colliderMaxX.clear();
+            colliderMaxY.clear();
+            colliderLayerBits.clear();
+            colliderLayerMasks.clear();
+            colliderVelocityX.clear();
+            colliderVelocityY.clear();
+            colliderIsFastMover.clear();
+            colliderTileMasks.clear();
+            fastMovers.clear();
+            for (auto [entity, transform, boxCollider]: registry.View<TransformComponent, BoxColliderComponent>()) {
+                const float x = transform.position.x + boxCollider.offset.x;
+                const float y = transform.position.y + boxCollider.offset.y;
+                // Colliders without a rigid body never move
+                glm::vec2 velocity = glm::vec2(0);
+                bool isFastMover = false;
+                const bool isStatic = !entity.HasComponent<RigidBodyComponent>();
+                if (!isStatic) {
+                    const RigidBodyComponent& rigidBody = entity.GetComponent<RigidBodyComponent>();
+                    velocity = rigidBody.velocity;
+                    isFastMover = rigidBody.isFastMover;
+                    if (isFastMover) {
+                        fastMovers.push_back(colliderEntities.size());
+                    }
+                }
+                colliderEntities.push_back(entity);
+                colliderEntityIds.push_back(entity.GetId());
+                colliderIsStatic.push_back(isStatic);
+                colliderVelocityX.push_back(velocity.x);
+                colliderVelocityY.push_back(velocity.y);
+                colliderIsFastMover.push_back(isFastMover);
+                colliderTileMasks.push_back(!isStatic && tileCollisionMap ? tileCollisionMap->GetBlockingMask(boxCollider.layer) : 0);
+                colliderMinX.push_back(x);
+                colliderMinY.push_back(y);
+                colliderMaxX.push_back(x + boxCollider.width);
+                colliderMaxY.push_back(y + boxCollider.height);
+                colliderLayerBits.push_back(CollisionMatrix::GetLayerBit(boxCollider.layer));
+                colliderLayerMasks.push_back(collisionMatrix.GetMask(boxCollider.layer));
+            }
+        }
+
+        // Tests each collider against its candidates in batches and writes the pairs that collide, in the order of the candidates.
+        // The candidates are split in chunks tested in parallel, whose pairs are merged in order.
+        void FindCollidingPairs(Registry& registry, bool isBruteForce) {
+            const BoxArrays boxes = { colliderMinX.data(), colliderMinY.data(), colliderMaxX.data(), colliderMaxY.data() };
+            const int numColliders = colliderEntities.size();
+            collidingPairs.clear();
+            if (isBruteForce) {
+                const int numChunks = (numColliders + BRUTE_FORCE_CHUNK_SIZE - 1) / BRUTE_FORCE_CHUNK_SIZE;
+                RunNarrowphaseChunks(registry, numChunks, [&](int chunk, NarrowphaseChunk& buffers) {
+                    buffers.overlapping.resize(numColliders);
+                    const int end = std::min<int>(numColliders, (chunk + 1) * BRUTE_FORCE_CHUNK_SIZE);
+                    for (int i = chunk * BRUTE_FORCE_CHUNK_SIZE; i < end; i++) {
+                        if (colliderLayerMasks[i] == 0) {
+                            continue;
+                        }
+                        const int numOverlapping = AABBBatch::OverlapsRange(boxes, i, i + 1, numColliders - i - 1, buffers.overlapping.data());
+                        for (int k = 0; k < numOverlapping; k++) {
+                            if (colliderLayerMasks[i] & colliderLayerBits[buffers.overlapping[k]]) {
+                                buffers.pairs.emplace_back(i, buffers.overlapping[k]);
+                            }
+                        }
+                    }
+                });
+                return;
+            }
+            const int numChunks = (candidatePairs.size() + NARROWPHASE_CHUNK_SIZE - 1) / NARROWPHASE_CHUNK_SIZE;
+            RunNarrowphaseChunks(registry, numChunks, [&](int chunk, NarrowphaseChunk& buffers) {
+                buffers.overlapping.resize(NARROWPHASE_CHUNK_SIZE);
+                const size_t end = std::min<size_t>(candidatePairs.size(), (chunk + 1) * NARROWPHASE_CHUNK_SIZE);
+                // The candidate pairs are sorted, so the candidates of each collider are next to each other (a chunk may
+                // start or end in the middle of them)
+                for (size_t pair = chunk * NARROWPHASE_CHUNK_SIZE; pair < end;) {
+                    const int i = candidatePairs[pair].first;
+                    buffers.candidates.clear();
+                    for (; pair < end && candidatePairs[pair].first == i; pair++) {
+                        buffers.candidates.push_back(candidatePairs[pair].second);
+                    }
+                    const int numOverlapping = AABBBatch::Overlaps(boxes, i, buffers.candidates.data(), buffers.candidates.size(), buffers.overlapping.data());
+                    for (int k = 0; k < numOverlapping; k++) {
+                        buffers.pairs.emplace_back(i, buffers.overlapping[k]);
+                    }
+                }
+            });
+        }
+
+        // Whether collider i, moving by its velocity for deltaTime, touches collider j moving by its own at some point of the move
+        bool CheckSweptCollision(int i, int j, double deltaTime) const {
+            // Move i relative to j, and follow the min corner of i through the box of j grown by the size of i
+            const double move[2] = { (colliderVelocityX[i] - colliderVelocityX[j]) * deltaTime, (colliderVelocityY[i] - colliderVelocityY[j]) * deltaTime };
+            const double start[2] = { colliderMinX[i], colliderMinY[i] };
+            const double grownMin[2] = { colliderMinX[j] - (colliderMaxX[i] - colliderMinX[i]), colliderMinY[j] - (colliderMaxY[i] - colliderMinY[i]) };
+            const double grownMax[2] = { colliderMaxX[j], colliderMaxY[j] };
+            double enter = 0.0;
+            double exit = 1.0;
+            for (int axis = 0; axis < 2; axis++) {
+                if (move[axis] == 0.0) {
+                    // Boxes that only touch don't collide
+                    if (start[axis] <= grownMin[axis] || start[axis] >= grownMax[axis]) {
+                        return false;
+                    }
+                    continue;
+                }
+                double near = (grownMin[axis] - start[axis]) / move[axis];
+                double far = (grownMax[axis] - start[axis]) / move[axis];
+                if (near > far) {
+                    std::swap(near, far);
+                }
+                enter = std::max(enter, near);
+                exit = std::min(exit, far);
+            }
+            return enter < exit;
+        }
+
+        // Adds the pairs of fast movers that collide at some point of the move they make in this frame, sweeping chunks of
+        // fast movers in parallel
+        void FindSweptPairs(Registry& registry, double deltaTime) {
+            const int numColliders = colliderEntities.size();
+            const BoxArrays boxes = { colliderMinX.data(), colliderMinY.data(), colliderMaxX.data(), colliderMaxY.data() };
+            const size_t numDiscretePairs = collidingPairs.size();
+
+            // The other colliders can also move during the frame, so the sweeps are grown by the longest move of the slow ones
+            float slowMoveX = 0.0f;
+            float slowMoveY = 0.0f;
+            for (int i = 0; i < numColliders; i++) {
+                if (!colliderIsFastMover[i]) {
+                    slowMoveX = std::max(slowMoveX, std::abs(colliderVelocityX[i]) * static_cast<float>(deltaTime));
+                    slowMoveY = std::max(slowMoveY, std::abs(colliderVelocityY[i]) * static_cast<float>(deltaTime));
+                }
+            }
+
+            // Boxes covered by the fast movers during their move (index = position in fastMovers)
+            const int numFastMovers = fastMovers.size();
+            sweptMinX.resize(numFastMovers);
+            sweptMinY.resize(numFastMovers);
+            sweptMaxX.resize(numFastMovers);
+            sweptMaxY.resize(numFastMovers);
+            for (int a = 0; a < numFastMovers; a++) {
+                const int i = fastMovers[a];
+                const float moveX = colliderVelocityX[i] * deltaTime;
+                const float moveY = colliderVelocityY[i] * deltaTime;
+                sweptMinX[a] = colliderMinX[i] + std::min(moveX, 0.0f);
+                sweptMinY[a] = colliderMinY[i] + std::min(moveY, 0.0f);
+                sweptMaxX[a] = colliderMaxX[i] + std::max(moveX, 0.0f);
+                sweptMaxY[a] = colliderMaxY[i] + std::max(moveY, 0.0f);
+            }
+            const BoxArrays sweptBoxes = { sweptMinX.data(), sweptMinY.data(), sweptMaxX.data(), sweptMaxY.data() };
+
+            const int numChunks = (numFastMovers + SWEEP_CHUNK_SIZE - 1) / SWEEP_CHUNK_SIZE;
+            RunNarrowphaseChunks(registry, numChunks, [&](int chunk, NarrowphaseChunk& buffers) {
+                buffers.overlapping.resize(std::max(numColliders, numFastMovers));
+                const int end = std::min<int>(numFastMovers, (chunk + 1) * SWEEP_CHUNK_SIZE);
+                for (int a = chunk * SWEEP_CHUNK_SIZE; a < end; a++) {
+                    const int i = fastMovers[a];
+                    if (colliderLayerMasks[i] == 0) {
+                        continue;
+                    }
+                    if (colliderVelocityX[i] != 0.0f || colliderVelocityY[i] != 0.0f) {
+                        const int numOverlapping = AABBBatch::OverlapsBoundsRange(
+                            boxes,
+                            sweptMinX[a] - slowMoveX,
+                            sweptMinY[a] - slowMoveY,
+                            sweptMaxX[a] + slowMoveX,
+                            sweptMaxY[a] + slowMoveY,
+                            0,
+                            numColliders,
+                            buffers.overlapping.data()
+                        );
+                        for (int k = 0; k < numOverlapping; k++) {
+                            const int j = buffers.overlapping[k];
+                            // Pairs of fast movers are checked below
+                            if (colliderIsFastMover[j] || !(colliderLayerMasks[i] & colliderLayerBits[j])) {
+                                continue;
+                            }
+                            if (CheckSweptCollision(i, j, deltaTime)) {
+                                buffers.pairs.emplace_back(std::min(i, j), std::max(i, j));
+                            }
+                        }
+                    }
+                    // The fast movers are in index order, so each pair of them is checked once, by the one with the lower index,
+                    // and only if their swept boxes overlap
+                    const int numOverlapping = AABBBatch::OverlapsRange(sweptBoxes, a, a + 1, numFastMovers - a - 1, buffers.overlapping.data());
+                    for (int k = 0; k < numOverlapping; k++) {
+                        const int j = fastMovers[buffers.overlapping[k]];
+                        if ((colliderLayerMasks[i] & colliderLayerBits[j]) && CheckSweptCollision(i, j, deltaTime)) {
+                            buffers.pairs.emplace_back(i, j);
+                        }
+                    }
+                }
+            });
+
+            // Most swept pairs also overlap at the start of the move, keep each pair once
+            std::sort(collidingPairs.begin(), collidingPairs.end());
+            collidingPairs.erase(std::unique(collidingPairs.begin(), collidingPairs.end()), collidingPairs.end());
+            contactCounters.numSweptContacts = collidingPairs.size() - numDiscretePairs;
+        }
+
+        // Finds the colliders that a map tile blocking their layer will stop during their move in this frame (the movement
+        // system stops them against the same tile), and emits a TileCollisionEvent for the ones that weren't stopped by a tile
+        // of that class in the last update, so a collider pressed against a wall isn't reported again every frame
+        void FindTileCollisions(Registry& registry, std::unique_ptr<EventBus>& eventBus, double deltaTime) {
+            std::swap(previousTileContacts, tileContacts);
+            tileContacts.clear();
+            const int numColliders = colliderEntities.size();
+            for (int i = 0; i < numColliders; i++) {
+                if (colliderTileMasks[i] == 0) {
+                    continue;
+                }
+                const AABB box = { colliderMinX[i], colliderMinY[i], colliderMaxX[i], colliderMaxY[i] };
+                double dx = colliderVelocityX[i] * deltaTime;
+                double dy = colliderVelocityY[i] * deltaTime;
+                const TileClass tileClass = tileCollisionMap->MoveBox(box, dx, dy, colliderTileMasks[i]);
+                if (tileClass != TileClass::Empty) {
+                    tileContacts.push_back(uint64_t(colliderEntityIds[i]) << 8 | static_cast<uint8_t>(tileClass));
+                }
+            }
+            std::sort(tileContacts.begin(), tileContacts.end());
+            contactCounters.numTileCollisions = tileContacts.size();
+
+            for (auto tileContact: tileContacts) {
+                if (std::binary_search(previousTileContacts.begin(), previousTileContacts.end(), tileContact) && !IsRemovedEntity(tileContact >> 8)) {
+                    continue;
+                }
+                Entity entity(tileContact >> 8);
+                entity.registry = &registry;
+                LOG_DEBUG(Physics, "Entity %d is stopped by a map tile.", entity.GetId());
+                contactCounters.numTileBegins++;
+                eventBus->EmitEvent<TileCollisionEvent>(entity, static_cast<TileClass>(tileContact & 0xFF));
+            }
+        }
+
+        // Adds the entity to the k nearest found so far (sorted by distance and then id, squared distances), returns the
+        // squared distance another collider has to be within to get in
+        static double InsertNearest(Entity entity, double distanceSquared, int k, Entity* entities, double* distancesSquared, int& count) {
+            int position = count < k ? count : k - 1;
+            if (count == k && (distanceSquared > distancesSquared[position] || (distanceSquared == distancesSquared[position] && entity.GetId() > entities[position].GetId()))) {
+                return distancesSquared[k - 1];
+            }
+            for (; position > 0 && (distancesSquared[position - 1] > distanceSquared || (distancesSquared[position - 1] == distanceSquared && entities[position - 1].GetId() > entity.GetId())); position--) {
+                entities[position] = entities[position - 1];
+                distancesSquared[position] = distancesSquared[position - 1];
+            }
+            entities[position] = entity;
+            distancesSquared[position] = distanceSquared;
+            count = std::min(count + 1, k);
+            return count == k ? distancesSquared[k - 1] : std::numeric_limits<double>::infinity();
+        }
+
+        AABB GetColliderBox(int i) const {
+            return { colliderMinX[i], colliderMinY[i], colliderMaxX[i], colliderMaxY[i] };
+        }
+
+        // Compares the contacts of this frame with the ones of the last frame, and emits events for the ones that changed
+        void UpdateContacts(Registry& registry, std::unique_ptr<EventBus>& eventBus) {
+            std::swap(previousContacts, contacts);
+            contacts.clear();
+            for (auto [i, j]: collidingPairs) {
+                const uint32_t a = colliderEntityIds[i];
+                const uint32_t b = colliderEntityIds[j];
+                contacts.push_back(a < b ? (uint64_t(a) << 32 | b) : (uint64_t(b) << 32 | a));
+            }
+            std::sort(contacts.begin(), contacts.end());
+
+            contactCounters.numContacts = contacts.size();
+            std::sort(removedEntityIds.begin(), removedEntityIds.end());
+
+            // Both lists are sorted, so a single merge finds the new, the kept and the gone contacts (in the same order for every
+            // broadphase and number of threads, as replays need)
+            size_t previous = 0;
+            size_t current = 0;
+            while (previous < previousContacts.size() || current < contacts.size()) {
+                const bool isEnd = current == contacts.size() || (previous < previousContacts.size() && previousContacts[previous] < contacts[current]);
+                const bool isBegin = !isEnd && (previous == previousContacts.size() || contacts[current] < previousContacts[previous]);
+                const uint64_t contact = isEnd ? previousContacts[previous] : contacts[current];
+                Entity a(contact >> 32);
+                Entity b(contact & 0xFFFFFFFF);
+                a.registry = &registry;
+                b.registry = &registry;
+                const bool isARemoved = !isBegin && IsRemovedEntity(a.GetId());
+                const bool isBRemoved = !isBegin && IsRemovedEntity(b.GetId());
+                // A kept contact with an entity that left the system belongs to a new entity that reused its id: the old
+                // contact ended and a new one began
+                const bool isReplaced = !isEnd && !isBegin && (isARemoved || isBRemoved);
+                if (isEnd || isReplaced) {
+                    LOG_DEBUG(Physics, "Entities %d and %d stopped colliding.", a.GetId(), b.GetId());
+                    contactCounters.numEnds++;
+                    eventBus->EmitEvent<CollisionEndEvent>(a, b, isARemoved, isBRemoved);
+                }
+                if (isBegin || isReplaced) {
+                    LOG_DEBUG(Physics, "Entities %d and %d started colliding.", a.GetId(), b.GetId());
+                    contactCounters.numBegins++;
+                    eventBus->EmitEvent<CollisionBeginEvent>(a, b);
+                }
+                if (!isEnd && !isBegin && !isReplaced && shouldEmitStayEvents) {
+                    eventBus->EmitEvent<CollisionStayEvent>(a, b);
+                }
+                if (!isBegin) {
+                    previous++;
+                }
+                if (!isEnd) {
+                    current++;
+                }
+            }
+        }
+
     public:
         CollisionSystem() {
             RequireComponent<TransformComponent>();
             RequireComponent<BoxColliderComponent>();
+            ReadsComponent<TransformComponent>();
+            ReadsComponent<BoxColliderComponent>();
+            ReadsComponent<RigidBodyComponent>();
+            // Collision and tile collision event handlers may kill entities (e.g. projectiles stopped by a wall)
+            ChangesEntities();
+        }
+
+        void OnEntityRemoved(Entity entity) override {
+            removedEntityIds.push_back(entity.GetId());
         }
 
         void SubscribeToEvents(std::unique_ptr<EventBus>& eventBus) {
             
         }
 
-        void Update(std::unique_ptr<Registry>& registry, std::unique_ptr<EventBus>& eventBus) {
-            auto entities = GetSystemEntities();
+        void SetBroadphase(Broadphase broadphase) {
+            this->broadphase = broadphase;
+        }
 
-            for (auto i = entities.begin(); i != entities.end(); i++) {
-                Entity a = *i;
-                const TransformComponent aTransform = a.GetComponent<TransformComponent>();
-                const BoxColliderComponent aBoxCollider = a.GetComponent<BoxColliderComponent>();
+        // Size of the spatial hash cells, a good value is the size of the map tiles (sizes that aren't positive are ignored)
+        void SetCellSize(double cellSize) {
+            if (!spatialHashGrid.SetCellSize(cellSize)) {
+                LOG_WARNING(Physics, "Ignored the spatial hash cell size %f, it must be positive (the cells stay %f)", cellSize, spatialHashGrid.GetCellSize());
+            }
+        }
+
+        // Whether to emit a CollisionStayEvent every frame for every contact (off by default, begin and end events are always emitted)
+        void SetEmitStayEvents(bool shouldEmitStayEvents) {
+            this->shouldEmitStayEvents = shouldEmitStayEvents;
+        }
 
-                for (auto j = i; j != entities.end(); j++) {
-                    Entity b = *j;
+        const ContactCounters& GetContactCounters() const {
+            return contactCounters;
+        }
 
-                    if (a == b) {
+        // Which collision layers interact with which, pairs of layers that don't interact are never tested
+        CollisionMatrix& GetCollisionMatrix() {
+            return collisionMatrix;
+        }
+
+        // Terrain the colliders are checked against, nullptr for none (the map must outlive the system)
+        void SetTileCollisionMap(const TileCollisionMap* tileCollisionMap) {
+            this->tileCollisionMap = tileCollisionMap;
+        }
+
+        // Point, box and ray queries against the colliders of the last update (kept up to date with Broadphase::AABBTree)
+        const ColliderTrees& GetColliderTrees() const {
+            return colliderTrees;
+        }
+
+        ///////////////////////////////////////////////////////////////////////
+        // Spatial queries against the colliders of the last update, for
+        // gameplay code ("what is near me", "can I see the player"). The
+        // layer mask picks the layers of the colliders that can be found
+        // (e.g. CollisionMatrix::GetLayerBit(CollisionLayer::Player), or
+        // GetCollisionMatrix().GetMask(layer) for the layers a layer
+        // interacts with). With Broadphase::AABBTree they run on the trees,
+        // with the other broadphases they test every collider. Results go to
+        // the caller's buffers: the queries don't allocate, and can run from
+        // several threads at once.
+        ///////////////////////////////////////////////////////////////////////
+
+        // Writes up to maxEntities entities whose collider overlaps the box (in no particular order), returns how many
+        int OverlapBox(const AABB& box, uint32_t layerMask, Entity* entities, int maxEntities) const {
+            int count = 0;
+            if (maxEntities <= 0) {
+                return count;
+            }
+            if (broadphase == Broadphase::AABBTree) {
+                colliderTrees.QueryBox(box, layerMask, [&](int id) {
+                    entities[count++] = colliderEntities[colliderTrees.GetIndex(id)];
+                    return count < maxEntities;
+                });
+                return count;
+            }
+            for (size_t i = 0; i < colliderEntities.size() && count < maxEntities; i++) {
+                if ((colliderLayerBits[i] & layerMask) && GetColliderBox(i).Overlaps(box)) {
+                    entities[count++] = colliderEntities[i];
+                }
+            }
+            return count;
+        }
+
+        // Writes up to maxEntities entities whose collider overlaps the circle (in no particular order), returns how many
+        int OverlapCircle(double x, double y, double radius, uint32_t layerMask, Entity* entities, int maxEntities) const {
+            int count = 0;
+            if (maxEntities <= 0) {
+                return count;
+            }
+            if (broadphase == Broadphase::AABBTree) {
+                colliderTrees.QueryCircle(x, y, radius, layerMask, [&](int id) {
+                    entities[count++] = colliderEntities[colliderTrees.GetIndex(id)];
+                    return count < maxEntities;
+                });
+                return count;
+            }
+            for (size_t i = 0; i < colliderEntities.size() && count < maxEntities; i++) {
+                if ((colliderLayerBits[i] & layerMask) && GetColliderBox(i).GetDistanceSquared(x, y) < radius * radius) {
+                    entities[count++] = colliderEntities[i];
+                }
+            }
+            return count;
+        }
+
+        // Finds the first collider crossed by the segment from (x0, y0) to (x1, y1) (the lowest entity id on ties), returns
+        // whether there was one
+        bool Raycast(double x0, double y0, double x1, double y1, uint32_t layerMask, RaycastHit& hit, Entity& entity) const {
+            int index = -1;
+            if (broadphase == Broadphase::AABBTree) {
+                if (colliderTrees.Raycast(x0, y0, x1, y1, hit, layerMask)) {
+                    index = colliderTrees.GetIndex(hit.id);
+                }
+            } else {
+                hit = RaycastHit();
+                for (size_t i = 0; i < colliderEntities.size(); i++) {
+                    double fraction;
+                    if (!(colliderLayerBits[i] & layerMask) || !GetColliderBox(i).IntersectsSegment(x0, y0, x1 - x0, y1 - y0, hit.fraction, fraction)) {
                         continue;
                     }
+                    if (index == -1 || fraction < hit.fraction || colliderEntityIds[i] < hit.id) {
+                        index = i;
+                        hit.id = colliderEntityIds[i];
+                        hit.fraction = fraction;
+                    }
+                }
+                hit.x = x0 + (x1 - x0) * hit.fraction;
+                hit.y = y0 + (y1 - y0) * hit.fraction;
+            }
+            if (index == -1) {
+                return false;
+            }
+            entity = colliderEntities[index];
+            return true;
+        }
 
-                    const TransformComponent bTransform = b.GetComponent<TransformComponent>();
-                    const BoxColliderComponent bBoxCollider = b.GetComponent<BoxColliderComponent>();
-
-                    bool boxCollisionHappened = CheckAABBCollision(
-                        aTransform.position.x + aBoxCollider.offset.x,
-                        aTransform.position.y + aBoxCollider.offset.y,
-                        aBoxCollider.width,
-                        aBoxCollider.height,
-                        bTransform.position.x + bBoxCollider.offset.x,
-                        bTransform.position.y + bBoxCollider.offset.y,
-                        bBoxCollider.width,
-                        bBoxCollider.height
-                    );
-
-                    if (boxCollisionHappened) {
-                        std::cout << "Emiting an event since entities " << a.GetId() << " and " << b.GetId() << " collided." << std::endl;
-                        eventBus->EmitEvent<CollisionEvent>(a, b);
+        // Writes the (up to) k entities whose collider is nearest to the point, nearest first (the lowest entity id on ties),
+        // and their distances (0 for a collider that contains the point); returns how many
+        int NearestK(double x, double y, int k, uint32_t layerMask, Entity* entities, double* distances) const {
+            int count = 0;
+            if (k <= 0) {
+                return count;
+            }
+            if (broadphase == Broadphase::AABBTree) {
+                colliderTrees.QueryNearest(x, y, layerMask, std::numeric_limits<double>::infinity(), [&](int id, double distanceSquared) {
+                    return InsertNearest(colliderEntities[colliderTrees.GetIndex(id)], distanceSquared, k, entities, distances, count);
+                });
+            } else {
+                double maxDistanceSquared = std::numeric_limits<double>::infinity();
+                for (size_t i = 0; i < colliderEntities.size(); i++) {
+                    const double distanceSquared = GetColliderBox(i).GetDistanceSquared(x, y);
+                    if ((colliderLayerBits[i] & layerMask) && distanceSquared <= maxDistanceSquared) {
+                        maxDistanceSquared = InsertNearest(colliderEntities[i], distanceSquared, k, entities, distances, count);
                     }
                 }
             }
+            for (int i = 0; i < count; i++) {
+                distances[i] = std::sqrt(distances[i]);
+            }
+            return count;
         }
 
-        bool CheckAABBCollision(double aX, double aY, double aW, double aH, double bX, double bY, double bW, double bH) {
-            return (
-                aX < bX + bW &&
-                aX + aW > bX &&
-                aY < bY + bH &&
-                aY + aH > bY
-            );
+        // Fast movers are swept along the move they make in the next deltaTime seconds (0 = no sweeping)
+        void Update(std::unique_ptr<Registry>& registry, std::unique_ptr<EventBus>& eventBus, double deltaTime = 0.0) {
+            contactCounters = ContactCounters();
+            GatherColliders(*registry);
+            const int numColliders = colliderEntities.size();
+
+            if (broadphase == Broadphase::SpatialHash) {
+                spatialHashGrid.FindPairs(colliderMinX.data(), colliderMinY.data(), colliderMaxX.data(), colliderMaxY.data(), colliderLayerBits.data(), colliderLayerMasks.data(), numColliders, candidatePairs);
+            } else if (broadphase == Broadphase::SweepAndPrune) {
+                sweepAndPrune.FindPairs(colliderEntityIds.data(), colliderMinX.data(), colliderMinY.data(), colliderMaxX.data(), colliderMaxY.data(), colliderLayerBits.data(), colliderLayerMasks.data(), numColliders, candidatePairs);
+            } else if (broadphase == Broadphase::AABBTree) {
+                colliderTrees.Update(colliderEntityIds.data(), colliderIsStatic.data(), colliderMinX.data(), colliderMinY.data(), colliderMaxX.data(), colliderMaxY.data(), colliderLayerBits.data(), colliderLayerMasks.data(), numColliders);
+                colliderTrees.FindPairs(candidatePairs);
+            }
+            FindCollidingPairs(*registry, broadphase == Broadphase::BruteForce);
+            // The movement system runs after this one, so fast movers are checked along the move they are about to make
+            if (deltaTime > 0.0 && !fastMovers.empty()) {
+                FindSweptPairs(*registry, deltaTime);
+            }
+
+            UpdateContacts(*registry, eventBus);
+            if (tileCollisionMap && deltaTime > 0.0) {
+                FindTileCollisions(*registry, eventBus, deltaTime);
+            } else {
+                tileContacts.clear();
+            }
+            removedEntityIds.clear();
         }
 };
 
@@ -4,6 +4,8 @@
 #include "../ECS/ECS.h"
 #include "../EventBus/EventBus.h"
 #include "../Components/HealthComponent.h"
+#include "../Events/CollisionBeginEvent.h"
+#include "../Logger/Logger.h"
 #include <glm/glm.hpp>
 
 class DamageSystem: public System {
@@ -13,13 +15,13 @@ class DamageSystem: public System {
         }
 
         void SubscribeToEvents(std::unique_ptr<EventBus>& eventBus) {
-            eventBus->ListenToEvent<CollisionEvent>(this, &DamageSystem::OnCollision);
+            eventBus->ListenToEvent<CollisionBeginEvent>(this, &DamageSystem::OnCollision);
         }
 
-        void OnCollision(CollisionEvent& event) {
+        void OnCollision(CollisionBeginEvent& event) {
             Entity a = event.a;
             Entity b = event.b;
-            std::cout << "Damage system detected collision between entity " << a.GetId() << " and " << b.GetId() << std::endl;
+            LOG_DEBUG(Physics, "Damage system detected collision between entity %d and %d", a.GetId(), b.GetId());
             
             // a.Kill();
             // b.Kill();
@@ -1,39 +1,65 @@
 #ifndef MOVEMENTSYSTEM_H
 #define MOVEMENTSYSTEM_H
 
-#include <iostream>
-
 #include "../ECS/ECS.h"
 #include "../EventBus/EventBus.h"
 #include "../Components/TransformComponent.h"
 #include "../Components/RigidBodyComponent.h"
+#include "../Components/BoxColliderComponent.h"
+#include "../Physics/TileCollisionMap.h"
+#include "../Logger/Logger.h"
 
 class MovementSystem: public System {
+    private:
+        // Terrain that stops the colliders whose layer it blocks, if any
+        const TileCollisionMap* tileCollisionMap = nullptr;
+
     public:
         MovementSystem() {
             RequireComponent<TransformComponent>();
             RequireComponent<RigidBodyComponent>();
+            WritesComponent<TransformComponent>();
+            ReadsComponent<RigidBodyComponent>();
+            ReadsComponent<BoxColliderComponent>();
+            // Entities that move beyond the limits of the map are killed
+            ChangesEntities();
         }
 
         void SubscribeToEvents(std::unique_ptr<EventBus>& eventBus) {
             
         }
 
+        // Terrain the colliders move against, nullptr for none (the map must outlive the system)
+        void SetTileCollisionMap(const TileCollisionMap* tileCollisionMap) {
+            this->tileCollisionMap = tileCollisionMap;
+        }
+
         void Update(std::unique_ptr<Registry>& registry, double deltaTime) {
-            for (auto entity: GetSystemEntities()) {
+            // Entities are moved in parallel chunks, the kills are deferred to the next registry update
+            const TileCollisionMap* tileCollisionMap = this->tileCollisionMap;
+            ParallelForEach<TransformComponent, RigidBodyComponent>(*registry, [deltaTime, tileCollisionMap](Entity entity, TransformComponent& transform, RigidBodyComponent& rigidbody) {
                 // Physical body movement
-                const RigidBodyComponent rigidbody = entity.GetComponent<RigidBodyComponent>();
-                TransformComponent& transform = entity.GetComponent<TransformComponent>();
-                    
-                transform.position.x += rigidbody.velocity.x * deltaTime;
-                transform.position.y += rigidbody.velocity.y * deltaTime;
+                double dx = rigidbody.velocity.x * deltaTime;
+                double dy = rigidbody.velocity.y * deltaTime;
+
+                // Colliders stop against the map tiles that block their layer
+                if (tileCollisionMap && entity.HasComponent<BoxColliderComponent>()) {
+                    const BoxColliderComponent& boxCollider = entity.GetComponent<BoxColliderComponent>();
+                    const float x = transform.position.x + boxCollider.offset.x;
+                    const float y = transform.position.y + boxCollider.offset.y;
+                    const AABB box = { x, y, x + static_cast<float>(boxCollider.width), y + static_cast<float>(boxCollider.height) };
+                    tileCollisionMap->MoveBox(box, dx, dy, tileCollisionMap->GetBlockingMask(boxCollider.layer));
+                }
+                transform.position.x += dx;
+                transform.position.y += dy;
+                transform.version++;
 
                 // Kill entities that move beyond the limits of the map
                 if (transform.position.x < 0 || transform.position.x > Game::mapWidth || transform.position.y < 0 || transform.position.y > Game::mapHeight) {
-                    std::cout << "Killing entity " << entity.GetId() << " because it went outside the boundaries of the map." << std::endl;
+                    LOG_DEBUG(ECS, "Killing entity %d because it went outside the boundaries of the map.", entity.GetId());
                     entity.Kill();
                 }
-            }
+            });
         }
 };
 
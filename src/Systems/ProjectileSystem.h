@@ -4,6 +4,7 @@
 #include "../ECS/ECS.h"
 #include "../EventBus/EventBus.h"
 #include "../Events/KeyPressedEvent.h"
+#include "../Events/TileCollisionEvent.h"
 #include "../Components/TransformComponent.h"
 #include "../Components/SpriteComponent.h"
 #include "../Components/KeyboardControlledComponent.h"
@@ -13,14 +14,32 @@
 #include "../Components/ProjectileEmitterComponent.h"
 
 class ProjectileSystem: public System {
+    private:
+        TextureHandle projectileTexture;
+
     public:
         ProjectileSystem() {
             RequireComponent<TransformComponent>();
             RequireComponent<ProjectileEmitterComponent>();
         }
 
+        // Texture of the sprite of the projectiles
+        void SetProjectileTexture(TextureHandle texture) {
+            projectileTexture = texture;
+        }
+
         void SubscribeToEvents(std::unique_ptr<EventBus>& eventBus) {
             eventBus->ListenToEvent<KeyPressedEvent>(this, &ProjectileSystem::OnKeyPressed);
+            eventBus->ListenToEvent<TileCollisionEvent>(this, &ProjectileSystem::OnTileCollision);
+        }
+
+        // Projectiles are destroyed by the map tiles that stop them (the kill is recorded in the registry commands, it is
+        // emitted by the CollisionSystem while it runs in the scheduler)
+        void OnTileCollision(TileCollisionEvent& event) {
+            const CollisionLayer layer = event.entity.GetComponent<BoxColliderComponent>().layer;
+            if (layer == CollisionLayer::PlayerProjectile || layer == CollisionLayer::EnemyProjectile) {
+                event.entity.registry->Commands().KillEntity(event.entity);
+            }
         }
 
         void OnKeyPressed(KeyPressedEvent& event) {
@@ -46,11 +65,13 @@ class ProjectileSystem: public System {
                         projectileVelocity.y = normalizedVelocityDirection.y * projectileVelocity.y;         // multiply by the velocity intensity factor of the projectile
                     }
 
-                    Entity projectile = entity.registry->CreateEntity();
-                    projectile.AddComponent<TransformComponent>(projectilePosition, glm::vec2(1, 1), 0.0);
-                    projectile.AddComponent<RigidBodyComponent>(projectileVelocity);
-                    projectile.AddComponent<SpriteComponent>("bullet-texture", 4, 4, 5);
-                    projectile.AddComponent<BoxColliderComponent>(glm::vec2(0), 4, 4);
+                    // The projectile is recorded in the registry commands, so it joins the systems in the next registry update
+                    CommandBuffer& commands = entity.registry->Commands();
+                    Entity projectile = commands.SpawnEntity(entity.registry);
+                    commands.AddComponent<TransformComponent>(projectile, projectilePosition, glm::vec2(1, 1), 0.0);
+                    commands.AddComponent<RigidBodyComponent>(projectile, projectileVelocity, true);
+                    commands.AddComponent<SpriteComponent>(projectile, projectileTexture, 4, 4, 5);
+                    commands.AddComponent<BoxColliderComponent>(projectile, glm::vec2(0), 4, 4, projectileComponent.isFriendly ? CollisionLayer::PlayerProjectile : CollisionLayer::EnemyProjectile);
                 }
             }
         }
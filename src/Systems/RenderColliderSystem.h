@@ -12,6 +12,8 @@ class RenderColliderSystem: public System {
         RenderColliderSystem() {
             RequireComponent<TransformComponent>();
             RequireComponent<BoxColliderComponent>();
+            ReadsComponent<TransformComponent>();
+            ReadsComponent<BoxColliderComponent>();
         }
 
         void SubscribeToEvents(std::unique_ptr<EventBus>& eventBus) {
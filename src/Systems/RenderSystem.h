@@ -2,63 +2,269 @@
 #define RENDERSYSTEM_H
 
 #include <SDL2/SDL.h>
+#include <cmath>
+#include <vector>
 #include "../ECS/ECS.h"
 #include "../EventBus/EventBus.h"
 #include "../Components/SpriteComponent.h"
 #include "../Components/TransformComponent.h"
 #include "../AssetStore/AssetStore.h"
+#include "../Physics/AABB.h"
+#include "../Render/RenderQueue.h"
+#include "../Render/SpriteBins.h"
 
-struct RenderableEntity {
-    TransformComponent transformComponent;
-    SpriteComponent spriteComponent;
+// How many sprites were drawn, skipped for being outside the camera, or skipped because their texture isn't loaded in the last update
+struct CullingCounters {
+    int numVisible = 0;
+    int numCulled = 0;
+    int numWithoutTexture = 0;
 };
 
 class RenderSystem: public System {
+    private:
+        ///////////////////////////////////////////////////////////////////////
+        // Sprites fixed to the screen are always drawn. The others are kept
+        // in world-space bins, and only the bins that overlap the camera are
+        // walked to find the visible ones. A sprite is moved to other bins
+        // when the version of its transform changed since it was placed
+        // (the transform was moved, rotated or scaled), and to the other
+        // group when it was fixed to the screen or released from it.
+        ///////////////////////////////////////////////////////////////////////
+        enum class SpriteGroup {
+            None,
+            Fixed,
+            World
+        };
+        struct SpritePlacement {
+            SpriteGroup group = SpriteGroup::None;
+            // Position in the list of the group
+            int index = -1;
+            // Version of the transform when the sprite was put in its bins
+            unsigned int transformVersion = 0;
+        };
+        std::vector<SpritePlacement> spritePlacements;
+        std::vector<Entity> fixedEntities;
+        std::vector<Entity> worldEntities;
+        SpriteBins spriteBins;
+
+        // Entities added to the system since the last update, placed in the update when their components are set
+        std::vector<Entity> addedEntities;
+
+        CullingCounters cullingCounters;
+
+        // Number of times the texture changed from one sprite drawn to the next in the last update (counting the first one)
+        int numTextureSwitches = 0;
+
+        RenderQueue renderQueue;
+
+        std::vector<Entity>* GetGroupEntities(SpriteGroup group) {
+            switch (group) {
+                case SpriteGroup::Fixed: return &fixedEntities;
+                case SpriteGroup::World: return &worldEntities;
+                default: return nullptr;
+            }
+        }
+
+        void AddToGroup(Entity entity, SpriteGroup group) {
+            SpritePlacement& placement = spritePlacements[entity.GetId()];
+            placement.group = group;
+            if (std::vector<Entity>* entities = GetGroupEntities(group)) {
+                placement.index = entities->size();
+                entities->push_back(entity);
+            }
+        }
+
+        void RemoveFromGroup(Entity entity) {
+            if (entity.GetId() >= static_cast<int>(spritePlacements.size())) {
+                return;
+            }
+            SpritePlacement& placement = spritePlacements[entity.GetId()];
+            if (std::vector<Entity>* entities = GetGroupEntities(placement.group)) {
+                // Swap the removed entity with the last one of the list and pop it
+                const Entity last = entities->back();
+                (*entities)[placement.index] = last;
+                spritePlacements[last.GetId()].index = placement.index;
+                entities->pop_back();
+            }
+            placement = SpritePlacement();
+        }
+
+        // Area covered by the sprite in world coordinates, grown to hold it at any angle if it is rotated (around its center)
+        static AABB GetSpriteBounds(const SpriteComponent& sprite, const TransformComponent& transform) {
+            const double width = sprite.width * transform.scale.x;
+            const double height = sprite.height * transform.scale.y;
+            AABB bounds;
+            bounds.minX = std::min<double>(transform.position.x, transform.position.x + width);
+            bounds.minY = std::min<double>(transform.position.y, transform.position.y + height);
+            bounds.maxX = std::max<double>(transform.position.x, transform.position.x + width);
+            bounds.maxY = std::max<double>(transform.position.y, transform.position.y + height);
+            if (transform.rotation != 0.0) {
+                const double centerX = (bounds.minX + bounds.maxX) * 0.5;
+                const double centerY = (bounds.minY + bounds.maxY) * 0.5;
+                const double radius = std::sqrt(width * width + height * height) * 0.5;
+                bounds = { centerX - radius, centerY - radius, centerX + radius, centerY + radius };
+            }
+            return bounds;
+        }
+
+        // Places the entity in its group, and in the bins if it isn't fixed to the screen
+        void PlaceEntity(Entity entity, const SpriteComponent& sprite, const TransformComponent& transform) {
+            if (sprite.isFixed) {
+                AddToGroup(entity, SpriteGroup::Fixed);
+                return;
+            }
+            spriteBins.Insert(entity, GetSpriteBounds(sprite, transform));
+            AddToGroup(entity, SpriteGroup::World);
+            spritePlacements[entity.GetId()].transformVersion = transform.version;
+        }
+
+        // Places the entities added since the last update
+        void PlaceAddedEntities() {
+            for (auto entity: addedEntities) {
+                if (entity.GetId() >= static_cast<int>(spritePlacements.size())) {
+                    spritePlacements.resize(entity.GetId() + 1);
+                }
+                // Skip the entities that left the system again, or were added twice
+                if (!HasEntity(entity) || spritePlacements[entity.GetId()].group != SpriteGroup::None) {
+                    continue;
+                }
+                PlaceEntity(entity, entity.GetComponent<SpriteComponent>(), entity.GetComponent<TransformComponent>());
+            }
+            addedEntities.clear();
+        }
+
+        // Moves the sprites whose transform changed to their new bins, and the sprites fixed to the screen or released from it to their new group
+        void UpdatePlacements(std::unique_ptr<Registry>& registry) {
+            // The components are walked in the order they are stored, which is much faster than looking them up entity by entity
+            for (auto [entity, sprite, transform]: registry->View<SpriteComponent, TransformComponent>()) {
+                if (entity.GetId() >= static_cast<int>(spritePlacements.size())) {
+                    continue;
+                }
+                SpritePlacement& placement = spritePlacements[entity.GetId()];
+                if (placement.group == SpriteGroup::None) {
+                    continue;
+                }
+                if (sprite.isFixed != (placement.group == SpriteGroup::Fixed)) {
+                    if (placement.group == SpriteGroup::World) {
+                        spriteBins.Remove(entity);
+                    }
+                    RemoveFromGroup(entity);
+                    PlaceEntity(entity, sprite, transform);
+                } else if (placement.group == SpriteGroup::World && placement.transformVersion != transform.version) {
+                    spriteBins.Move(entity, GetSpriteBounds(sprite, transform));
+                    placement.transformVersion = transform.version;
+                }
+            }
+        }
+
+        // Submits the sprite of the entity to the render queue, which keeps them sorted by layer, texture and y across frames
+        void SubmitSprite(Entity entity, const SpriteComponent& sprite, const TransformComponent& transform, std::unique_ptr<AssetStore>& assetStore) {
+            // Sprites whose texture isn't loaded (or was cleared since they were made) aren't drawn
+            const TextureRegion* region = assetStore->GetTextureRegion(sprite.texture);
+            if (!region) {
+                cullingCounters.numWithoutTexture++;
+                return;
+            }
+
+            // The source rectangle of the sprite is relative to its image, which may be packed in an atlas
+            const int entityId = entity.GetId();
+            DrawItem item;
+            item.texture = region->texture;
+            item.srcRect = sprite.srcRect;
+            item.srcRect.x += region->rect.x;
+            item.srcRect.y += region->rect.y;
+            item.x = transform.position.x;
+            item.y = transform.position.y;
+            item.width = sprite.width * transform.scale.x;
+            item.height = sprite.height * transform.scale.y;
+            item.rotation = transform.rotation;
+            item.isFixed = sprite.isFixed;
+            item.key = RenderQueue::MakeKey(sprite.zIndex, region->textureIndex, item.y + item.height, entityId);
+            renderQueue.Submit(entityId, item);
+        }
+
     public:
         RenderSystem() {
             RequireComponent<SpriteComponent>();
             RequireComponent<TransformComponent>();
+            ReadsComponent<SpriteComponent>();
+            ReadsComponent<TransformComponent>();
+        }
+
+        void OnEntityAdded(Entity entity) override {
+            addedEntities.push_back(entity);
+        }
+
+        void OnEntityRemoved(Entity entity) override {
+            spriteBins.Remove(entity);
+            RemoveFromGroup(entity);
         }
 
         void SubscribeToEvents(std::unique_ptr<EventBus>& eventBus) {
             
         }
 
+        const RenderQueueCounters& GetRenderQueueCounters() const {
+            return renderQueue.GetCounters();
+        }
+
+        const CullingCounters& GetCullingCounters() const {
+            return cullingCounters;
+        }
+
+        int GetNumTextureSwitches() const {
+            return numTextureSwitches;
+        }
+
         void Update(std::unique_ptr<Registry>& registry, SDL_Renderer* renderer, std::unique_ptr<AssetStore>& assetStore, SDL_Rect& camera) {
-            // Sort entities by zIndex
-            std::vector<RenderableEntity> renderableEntities;
-            for (auto entity: GetSystemEntities()) {
-                RenderableEntity renderableEntity;
-                renderableEntity.spriteComponent = entity.GetComponent<SpriteComponent>();
-                renderableEntity.transformComponent = entity.GetComponent<TransformComponent>();
-                renderableEntities.emplace_back(renderableEntity);
+            PlaceAddedEntities();
+            UpdatePlacements(registry);
+
+            // Submit the sprites fixed to the screen and the sprites that overlap the camera
+            cullingCounters.numWithoutTexture = 0;
+            renderQueue.Begin();
+            for (auto entity: fixedEntities) {
+                SubmitSprite(entity, entity.GetComponent<SpriteComponent>(), entity.GetComponent<TransformComponent>(), assetStore);
             }
-            sort(renderableEntities.begin(), renderableEntities.end(), [](const RenderableEntity& a, const RenderableEntity& b) { 
-                return a.spriteComponent.zIndex < b.spriteComponent.zIndex;
+            AABB cameraBounds;
+            cameraBounds.minX = camera.x;
+            cameraBounds.minY = camera.y;
+            cameraBounds.maxX = camera.x + camera.w;
+            cameraBounds.maxY = camera.y + camera.h;
+            spriteBins.Query(cameraBounds, [&](Entity entity) {
+                const auto& sprite = entity.GetComponent<SpriteComponent>();
+                const auto& transform = entity.GetComponent<TransformComponent>();
+                if (GetSpriteBounds(sprite, transform).Overlaps(cameraBounds)) {
+                    SubmitSprite(entity, sprite, transform, assetStore);
+                }
             });
+            renderQueue.End();
+            cullingCounters.numVisible = renderQueue.GetCounters().numItems;
+            cullingCounters.numCulled = GetSystemEntities().size() - cullingCounters.numVisible - cullingCounters.numWithoutTexture;
 
-            for (auto renderableEntity: renderableEntities) {
-                const SpriteComponent sprite = renderableEntity.spriteComponent;
-                const TransformComponent transform = renderableEntity.transformComponent;
-
-                // Set the source rectangle of our original sprite texture
-                SDL_Rect srcRect = sprite.srcRect;
+            numTextureSwitches = 0;
+            SDL_Texture* previousTexture = nullptr;
+            for (const auto& item: renderQueue.GetItems()) {
+                if (item.texture != previousTexture) {
+                    numTextureSwitches++;
+                    previousTexture = item.texture;
+                }
 
                 // Set the destination rectangle in the x,y position in the renderer considering the camera position
                 SDL_Rect dstRect = {
-                    static_cast<int>(transform.position.x - (sprite.isFixed ? 0 : camera.x)),
-                    static_cast<int>(transform.position.y - (sprite.isFixed ? 0 : camera.y)),
-                    static_cast<int>(sprite.width * transform.scale.x),
-                    static_cast<int>(sprite.height * transform.scale.y)
+                    static_cast<int>(item.x - (item.isFixed ? 0 : camera.x)),
+                    static_cast<int>(item.y - (item.isFixed ? 0 : camera.y)),
+                    static_cast<int>(item.width),
+                    static_cast<int>(item.height)
                 };
 
                 // Draw the sprite texture in the renderer (destination rectangle)
                 SDL_RenderCopyEx(
                     renderer,
-                    assetStore->GetTexture(sprite.assetId),
-                    &srcRect,
+                    item.texture,
+                    &item.srcRect,
                     &dstRect,
-                    transform.rotation,
+                    item.rotation,
                     NULL,
                     SDL_FLIP_NONE
                 );
@@ -66,4 +272,4 @@ class RenderSystem: public System {
         }
 };
 
-#endif
\ No newline at end of file
+#endif
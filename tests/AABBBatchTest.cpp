@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////////
+// AABBBatchTest
+///////////////////////////////////////////////////////////////////////////////
+// Checks the batch AABB tests of every SIMD level the CPU supports against
+// the scalar one, bit for bit: random, touching and zero-size boxes plus
+// +-0, +-inf, NaN, denormals and 1e30 as coordinates, with indexed and
+// range candidates. The scalar level is first checked against the per-pair
+// test the CollisionSystem used before the batch tests, on boxes with whole
+// coordinates (where the old double sums are exact). Exits with 1 on the
+// first mismatch.
+// Run with: make test
+///////////////////////////////////////////////////////////////////////////////
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+#include "../src/Physics/AABBBatch.h"
+
+// The per-pair test of the CollisionSystem before the batch tests (position and size)
+static bool CheckAABBCollision(double aX, double aY, double aW, double aH, double bX, double bY, double bW, double bH) {
+    return (
+        aX < bX + bW &&
+        aX + aW > bX &&
+        aY < bY + bH &&
+        aY + aH > bY
+    );
+}
+
+static const char* GetSimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar: return "scalar";
+        case SimdLevel::SSE2: return "SSE2";
+        case SimdLevel::AVX2: return "AVX2";
+        case SimdLevel::AVX512: return "AVX-512";
+    }
+    return "unknown";
+}
+
+// Random boxes, a tenth of them with special values as coordinates if asked
+static void MakeBoxes(std::mt19937& random, int count, bool hasSpecialValues, std::vector<float> coordinates[4]) {
+    const float specialValues[] = {
+        0.0f, -0.0f, 1.0f, 16.0f,
+        std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::denorm_min(), 1e30f
+    };
+    const int numSpecialValues = sizeof(specialValues) / sizeof(specialValues[0]);
+    for (int i = 0; i < 4; i++) {
+        coordinates[i].resize(count);
+    }
+    for (int i = 0; i < count; i++) {
+        if (hasSpecialValues && random() % 10 == 0) {
+            for (int j = 0; j < 4; j++) {
+                coordinates[j][i] = specialValues[random() % numSpecialValues];
+            }
+            continue;
+        }
+        coordinates[0][i] = random() % 64;
+        coordinates[1][i] = random() % 64;
+        coordinates[2][i] = coordinates[0][i] + random() % 16;
+        coordinates[3][i] = coordinates[1][i] + random() % 16;
+    }
+}
+
+static bool HasSameResults(int count, const int* results, int expectedCount, const int* expected) {
+    return count == expectedCount && memcmp(results, expected, count * sizeof(int)) == 0;
+}
+
+int main() {
+    std::mt19937 random(7);
+
+    // The scalar level against the old per-pair test
+    AABBBatch::SetSimdLevel(SimdLevel::Scalar);
+    long numPairs = 0;
+    for (int round = 0; round < 100; round++) {
+        const int count = 1 + random() % 300;
+        std::vector<float> coordinates[4];
+        MakeBoxes(random, count, false, coordinates);
+        const BoxArrays boxes = { coordinates[0].data(), coordinates[1].data(), coordinates[2].data(), coordinates[3].data() };
+        std::vector<int> overlapping(count);
+        for (int box = 0; box < count; box++) {
+            const int numOverlapping = AABBBatch::OverlapsRange(boxes, box, 0, count, overlapping.data());
+            std::vector<int> expected;
+            for (int other = 0; other < count; other++) {
+                if (CheckAABBCollision(
+                    boxes.minX[box], boxes.minY[box], boxes.maxX[box] - boxes.minX[box], boxes.maxY[box] - boxes.minY[box],
+                    boxes.minX[other], boxes.minY[other], boxes.maxX[other] - boxes.minX[other], boxes.maxY[other] - boxes.minY[other]
+                )) {
+                    expected.push_back(other);
+                }
+            }
+            if (!HasSameResults(numOverlapping, overlapping.data(), expected.size(), expected.data())) {
+                printf("FAILED: scalar batch test differs from CheckAABBCollision (round %d, box %d)\n", round, box);
+                return 1;
+            }
+            numPairs += count;
+        }
+    }
+
+    // Every supported level against the scalar one
+    const SimdLevel supportedLevel = AABBBatch::GetSupportedSimdLevel();
+    long numComparisons = 0;
+    for (int round = 0; round < 300; round++) {
+        const int count = 1 + random() % 300;
+        std::vector<float> coordinates[4];
+        MakeBoxes(random, count, true, coordinates);
+        const BoxArrays boxes = { coordinates[0].data(), coordinates[1].data(), coordinates[2].data(), coordinates[3].data() };
+        std::vector<int> candidates;
+        for (int i = 0; i < count; i++) {
+            if (random() % 2) {
+                candidates.push_back(i);
+            }
+        }
+        std::vector<int> expected(count);
+        std::vector<int> expectedRange(count);
+        std::vector<int> overlapping(count);
+        for (int box = 0; box < count; box++) {
+            const int first = random() % count;
+            AABBBatch::SetSimdLevel(SimdLevel::Scalar);
+            const int numExpected = AABBBatch::Overlaps(boxes, box, candidates.data(), candidates.size(), expected.data());
+            const int numExpectedRange = AABBBatch::OverlapsRange(boxes, box, first, count - first, expectedRange.data());
+            for (int level = static_cast<int>(SimdLevel::SSE2); level <= static_cast<int>(supportedLevel); level++) {
+                AABBBatch::SetSimdLevel(static_cast<SimdLevel>(level));
+                int numOverlapping = AABBBatch::Overlaps(boxes, box, candidates.data(), candidates.size(), overlapping.data());
+                if (!HasSameResults(numOverlapping, overlapping.data(), numExpected, expected.data())) {
+                    printf("FAILED: %s differs from scalar with indexed candidates (round %d, box %d)\n", GetSimdLevelName(static_cast<SimdLevel>(level)), round, box);
+                    return 1;
+                }
+                numOverlapping = AABBBatch::OverlapsRange(boxes, box, first, count - first, overlapping.data());
+                if (!HasSameResults(numOverlapping, overlapping.data(), numExpectedRange, expectedRange.data())) {
+                    printf("FAILED: %s differs from scalar with range candidates (round %d, box %d)\n", GetSimdLevelName(static_cast<SimdLevel>(level)), round, box);
+                    return 1;
+                }
+                numComparisons += 2;
+            }
+        }
+    }
+    printf("AABBBatchTest: scalar matches CheckAABBCollision on %ld pairs, levels up to %s match scalar in %ld batches\n",
+        numPairs, GetSimdLevelName(supportedLevel), numComparisons);
+    return 0;
+}
@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+// CollisionBroadphaseTest
+///////////////////////////////////////////////////////////////////////////////
+// Cross-checks the broadphases of the CollisionSystem against the brute
+// force one: on 90 random worlds (negative coordinates, boxes larger than
+// the cells, touching boxes on a regular grid, cell sizes of 8, 64 and
+// 1000) every broadphase must report the same collision begin events, in
+// the same order. All colliders have a rigid body, since the AABB trees
+// never pair two static colliders. Also checks that the spatial hash grid
+// rejects cell sizes that aren't positive. Exits with 1 on the first
+// mismatch.
+// Run with: make test
+///////////////////////////////////////////////////////////////////////////////
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+#include "../src/ECS/ECS.h"
+#include "../src/EventBus/EventBus.h"
+#include "../src/Physics/SpatialHashGrid.h"
+#include "../src/Systems/CollisionSystem.h"
+
+class PairRecorder {
+    public:
+        std::vector<std::pair<int, int>> pairs;
+
+        void OnCollisionBegin(CollisionBeginEvent& event) {
+            pairs.emplace_back(event.a.GetId(), event.b.GetId());
+        }
+};
+
+// Makes a world of random boxes (or boxes on a grid 32 pixels apart) and returns the contacts of its first update
+static std::vector<std::pair<int, int>> FindContacts(Broadphase broadphase, double cellSize, int numColliders, double worldSize, int maxBoxSize, int seed, bool isGrid) {
+    auto registry = std::make_unique<Registry>();
+    registry->AddSystem<CollisionSystem>();
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> position(-worldSize / 2, worldSize);
+    for (int i = 0; i < numColliders; i++) {
+        Entity entity = registry->CreateEntity();
+        glm::vec2 boxPosition = isGrid ? glm::vec2((i % 50) * 32, (i / 50) * 32) : glm::vec2(position(random), position(random));
+        const int offsetX = random() % 5;
+        const int offsetY = random() % 5;
+        const int width = 1 + random() % maxBoxSize;
+        const int height = 1 + random() % maxBoxSize;
+        entity.AddComponent<TransformComponent>(boxPosition, glm::vec2(1.0, 1.0), 0.0);
+        entity.AddComponent<RigidBodyComponent>();
+        entity.AddComponent<BoxColliderComponent>(glm::vec2(offsetX, offsetY), width, height);
+    }
+    registry->Update();
+
+    auto eventBus = std::make_unique<EventBus>();
+    PairRecorder recorder;
+    eventBus->ListenToEvent<CollisionBeginEvent>(&recorder, &PairRecorder::OnCollisionBegin);
+    CollisionSystem& collisionSystem = registry->GetSystem<CollisionSystem>();
+    collisionSystem.SetBroadphase(broadphase);
+    collisionSystem.SetCellSize(cellSize);
+    collisionSystem.Update(registry, eventBus);
+    return recorder.pairs;
+}
+
+int main() {
+    const std::pair<Broadphase, const char*> broadphases[] = {
+        { Broadphase::SpatialHash, "spatial hash" },
+        { Broadphase::SweepAndPrune, "sweep and prune" },
+        { Broadphase::AABBTree, "AABB tree" }
+    };
+    SpatialHashGrid grid(64.0);
+    for (double cellSize: { 0.0, -8.0, std::nan("") }) {
+        if (grid.SetCellSize(cellSize) || grid.GetCellSize() != 64.0) {
+            printf("FAILED: the spatial hash grid took the cell size %f\n", cellSize);
+            return 1;
+        }
+    }
+
+    size_t numContacts = 0;
+    for (int seed = 0; seed < 30; seed++) {
+        for (double cellSize: { 8.0, 64.0, 1000.0 }) {
+            const int numColliders = 300 + seed * 20;
+            const double worldSize = 500 + seed * 50;
+            const int maxBoxSize = seed % 3 == 0 ? 300 : 40;
+            const bool isGrid = seed % 5 == 0;
+            const auto expected = FindContacts(Broadphase::BruteForce, cellSize, numColliders, worldSize, maxBoxSize, seed, isGrid);
+            for (const auto& [broadphase, name]: broadphases) {
+                const auto contacts = FindContacts(broadphase, cellSize, numColliders, worldSize, maxBoxSize, seed, isGrid);
+                if (contacts != expected) {
+                    printf("FAILED: %s found %zu contacts and brute force %zu (seed %d, cell size %.0f)\n", name, contacts.size(), expected.size(), seed, cellSize);
+                    return 1;
+                }
+            }
+            numContacts += expected.size();
+        }
+    }
+    printf("CollisionBroadphaseTest: all broadphases match brute force on 90 worlds (%zu contacts)\n", numContacts);
+    return 0;
+}
@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////////
+// CollisionQueryTest
+///////////////////////////////////////////////////////////////////////////////
+// Cross-checks the spatial queries of the CollisionSystem on the AABB trees
+// against the same queries scanning every collider (the spatial hash
+// broadphase keeps no index, so its queries scan): 2000 random OverlapBox,
+// OverlapCircle, NearestK and Raycast queries each, with all layers or two
+// of them, on 100k colliders (half static, 7 layers) in a 20000x20000
+// world. Overlaps are compared as sets, NearestK and Raycast exactly.
+// Exits with 1 if any query differs.
+// Run with: make test
+///////////////////////////////////////////////////////////////////////////////
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <set>
+#include <vector>
+#include "../src/ECS/ECS.h"
+#include "../src/EventBus/EventBus.h"
+#include "../src/Systems/CollisionSystem.h"
+
+const int NUM_COLLIDERS = 100000;
+const int WORLD_SIZE = 20000;
+
+// The same random world in each registry, with the colliders gathered by an update with the broadphase
+static std::unique_ptr<Registry> MakeWorld(Broadphase broadphase) {
+    std::mt19937 random(3);
+    auto registry = std::make_unique<Registry>();
+    registry->AddSystem<CollisionSystem>();
+    for (int i = 0; i < NUM_COLLIDERS; i++) {
+        Entity entity = registry->CreateEntity();
+        entity.AddComponent<TransformComponent>(glm::vec2(random() % WORLD_SIZE, random() % WORLD_SIZE), glm::vec2(1.0, 1.0), 0.0);
+        const int width = random() % 40 + 1;
+        const int height = random() % 40 + 1;
+        entity.AddComponent<BoxColliderComponent>(glm::vec2(0), width, height, static_cast<CollisionLayer>(random() % 7));
+        if (i % 2) {
+            entity.AddComponent<RigidBodyComponent>();
+        }
+    }
+    registry->Update();
+    auto eventBus = std::make_unique<EventBus>();
+    CollisionSystem& collisionSystem = registry->GetSystem<CollisionSystem>();
+    collisionSystem.SetBroadphase(broadphase);
+    collisionSystem.SetCellSize(64.0);
+    collisionSystem.Update(registry, eventBus);
+    return registry;
+}
+
+static std::set<int> GetIds(const std::vector<Entity>& entities, int count) {
+    std::set<int> ids;
+    for (int i = 0; i < count; i++) {
+        ids.insert(entities[i].GetId());
+    }
+    return ids;
+}
+
+int main() {
+    auto treeRegistry = MakeWorld(Broadphase::AABBTree);
+    auto scanRegistry = MakeWorld(Broadphase::SpatialHash);
+    const CollisionSystem& trees = treeRegistry->GetSystem<CollisionSystem>();
+    const CollisionSystem& scan = scanRegistry->GetSystem<CollisionSystem>();
+
+    const uint32_t allLayers = ~uint32_t(0);
+    const uint32_t twoLayers = CollisionMatrix::GetLayerBit(CollisionLayer::Player) | CollisionMatrix::GetLayerBit(CollisionLayer::Enemy);
+    std::vector<Entity> treeEntities(NUM_COLLIDERS, Entity(-1));
+    std::vector<Entity> scanEntities(NUM_COLLIDERS, Entity(-1));
+    std::vector<double> treeDistances(16);
+    std::vector<double> scanDistances(16);
+    std::mt19937 random(3);
+    int numQueries = 0;
+    int numMismatches = 0;
+    for (int i = 0; i < 2000; i++) {
+        const double x = random() % WORLD_SIZE;
+        const double y = random() % WORLD_SIZE;
+        const uint32_t layerMask = i % 2 ? allLayers : twoLayers;
+        const double size = random() % 300 + 1;
+
+        const AABB box = { x, y, x + size, y + size * 0.5 };
+        int treeCount = trees.OverlapBox(box, layerMask, treeEntities.data(), NUM_COLLIDERS);
+        int scanCount = scan.OverlapBox(box, layerMask, scanEntities.data(), NUM_COLLIDERS);
+        numMismatches += GetIds(treeEntities, treeCount) != GetIds(scanEntities, scanCount);
+
+        treeCount = trees.OverlapCircle(x, y, size, layerMask, treeEntities.data(), NUM_COLLIDERS);
+        scanCount = scan.OverlapCircle(x, y, size, layerMask, scanEntities.data(), NUM_COLLIDERS);
+        numMismatches += GetIds(treeEntities, treeCount) != GetIds(scanEntities, scanCount);
+
+        const int k = random() % 16 + 1;
+        treeCount = trees.NearestK(x, y, k, layerMask, treeEntities.data(), treeDistances.data());
+        scanCount = scan.NearestK(x, y, k, layerMask, scanEntities.data(), scanDistances.data());
+        bool isSame = treeCount == scanCount;
+        for (int j = 0; isSame && j < treeCount; j++) {
+            isSame = treeEntities[j].GetId() == scanEntities[j].GetId() && treeDistances[j] == scanDistances[j];
+        }
+        numMismatches += !isSame;
+
+        const double endX = x + static_cast<int>(random() % 2000) - 1000;
+        const double endY = y + static_cast<int>(random() % 2000) - 1000;
+        RaycastHit treeHit;
+        RaycastHit scanHit;
+        Entity treeEntity(-1);
+        Entity scanEntity(-1);
+        const bool isTreeHit = trees.Raycast(x, y, endX, endY, layerMask, treeHit, treeEntity);
+        const bool isScanHit = scan.Raycast(x, y, endX, endY, layerMask, scanHit, scanEntity);
+        isSame = isTreeHit == isScanHit;
+        if (isSame && isTreeHit) {
+            isSame = treeEntity.GetId() == scanEntity.GetId() && treeHit.fraction == scanHit.fraction && treeHit.x == scanHit.x && treeHit.y == scanHit.y;
+        }
+        numMismatches += !isSame;
+        numQueries += 4;
+    }
+    if (numMismatches != 0) {
+        printf("FAILED: %d of %d queries differ between the trees and the scan\n", numMismatches, numQueries);
+        return 1;
+    }
+    printf("CollisionQueryTest: %d queries on the trees match the scan\n", numQueries);
+    return 0;
+}
@@ -0,0 +1,189 @@
+///////////////////////////////////////////////////////////////////////////////
+// ContinuousCollisionTest
+///////////////////////////////////////////////////////////////////////////////
+// Regression check of the sweeping of fast movers in the CollisionSystem.
+// 1. Stress: 4x4 bullets at 400 to 2400 px/s are fired at 4 px thick walls
+//    for two seconds at 20, 30 and 60 Hz, the collision update running
+//    before the bullets move, like in the game. Reports the bullets that
+//    never hit their wall with discrete checks and with sweeping, which
+//    must not miss any.
+// 2. Random scenes: the begin events of one swept update are compared with
+//    the contacts found by sampling the frame in 4000 steps. No sampled
+//    contact may be missing, and a contact only the sweep finds must show
+//    up with 400000 steps.
+// Exits with 1 when a check fails.
+// Run with: make test
+///////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+#include "../src/ECS/ECS.h"
+#include "../src/EventBus/EventBus.h"
+#include "../src/Systems/CollisionSystem.h"
+
+class ContactRecorder {
+    public:
+        // Pairs of entity ids (lower id first) that began colliding since the last clear
+        std::set<std::pair<int, int>> begins;
+
+        void OnCollisionBegin(CollisionBeginEvent& event) {
+            begins.emplace(std::min(event.a.GetId(), event.b.GetId()), std::max(event.a.GetId(), event.b.GetId()));
+        }
+};
+
+// Number of bullets that hit their wall in two seconds at the update rate, out of 800
+static int FireAtWalls(int updatesPerSecond, bool isSwept) {
+    int numHits = 0;
+    for (int speed: { 400, 800, 1600, 2400 }) {
+        std::mt19937 random(speed);
+        auto registry = std::make_unique<Registry>();
+        registry->AddSystem<CollisionSystem>();
+        for (int i = 0; i < 10; i++) {
+            Entity wall = registry->CreateEntity();
+            wall.AddComponent<TransformComponent>(glm::vec2(300, i * 100), glm::vec2(1.0, 1.0), 0.0);
+            wall.AddComponent<BoxColliderComponent>(glm::vec2(0), 4, 64, CollisionLayer::Vegetation);
+        }
+        std::vector<Entity> bullets;
+        for (int i = 0; i < 200; i++) {
+            Entity bullet = registry->CreateEntity();
+            const float y = (i % 10) * 100 + random() % 60;
+            bullet.AddComponent<TransformComponent>(glm::vec2(random() % 200, y), glm::vec2(1.0, 1.0), 0.0);
+            bullet.AddComponent<BoxColliderComponent>(glm::vec2(0), 4, 4, CollisionLayer::PlayerProjectile);
+            bullet.AddComponent<RigidBodyComponent>(glm::vec2(speed, 0), true);
+            bullets.push_back(bullet);
+        }
+        registry->Update();
+
+        auto eventBus = std::make_unique<EventBus>();
+        ContactRecorder recorder;
+        eventBus->ListenToEvent<CollisionBeginEvent>(&recorder, &ContactRecorder::OnCollisionBegin);
+        CollisionSystem& collisionSystem = registry->GetSystem<CollisionSystem>();
+        const double deltaTime = 1.0 / updatesPerSecond;
+        std::set<int> hitBullets;
+        for (int frame = 0; frame < 2 * updatesPerSecond; frame++) {
+            collisionSystem.Update(registry, eventBus, isSwept ? deltaTime : 0.0);
+            for (const auto& begin: recorder.begins) {
+                hitBullets.insert(begin.second);
+            }
+            recorder.begins.clear();
+            for (auto bullet: bullets) {
+                bullet.GetComponent<TransformComponent>().position.x += speed * deltaTime;
+            }
+        }
+        numHits += hitBullets.size();
+    }
+    return numHits;
+}
+
+struct Body {
+    float x, y, width, height;
+    float velocityX, velocityY;
+    bool isFastMover;
+    bool isDynamic;
+};
+
+static bool OverlapAt(const Body& a, const Body& b, double time) {
+    const double aX = a.x + a.velocityX * time;
+    const double aY = a.y + a.velocityY * time;
+    const double bX = b.x + b.velocityX * time;
+    const double bY = b.y + b.velocityY * time;
+    return aX < bX + b.width && bX < aX + a.width && aY < bY + b.height && bY < aY + a.height;
+}
+
+// Whether the bodies overlap at some of the steps of the frame
+static bool OverlapDuring(const Body& a, const Body& b, double deltaTime, int numSteps) {
+    for (int step = 0; step <= numSteps; step++) {
+        if (OverlapAt(a, b, deltaTime * step / numSteps)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int main() {
+    bool hasFailed = false;
+    for (int updatesPerSecond: { 20, 30, 60 }) {
+        const int numFired = 800;
+        const int numDiscreteHits = FireAtWalls(updatesPerSecond, false);
+        const int numSweptHits = FireAtWalls(updatesPerSecond, true);
+        printf("%2d Hz: discrete missed %d of %d bullets, swept missed %d\n", updatesPerSecond, numFired - numDiscreteHits, numFired, numFired - numSweptHits);
+        if (numSweptHits != numFired) {
+            printf("FAILED: swept bullets missed their wall at %d Hz\n", updatesPerSecond);
+            hasFailed = true;
+        }
+    }
+
+    const double deltaTime = 1.0 / 20;
+    int numSampledContacts = 0;
+    int numMissing = 0;
+    int numFalse = 0;
+    for (int seed = 0; seed < 200; seed++) {
+        std::mt19937 random(seed);
+        auto registry = std::make_unique<Registry>();
+        registry->AddSystem<CollisionSystem>();
+        std::vector<std::pair<Entity, Body>> bodies;
+        for (int i = 0; i < 80; i++) {
+            Body body = { float(random() % 400), float(random() % 400), float(random() % 20 + 1), float(random() % 20 + 1), 0.0f, 0.0f, false, false };
+            const int kind = random() % 4;
+            if (kind == 0) {
+                body.isFastMover = body.isDynamic = true;
+                body.width = body.height = 4;
+                body.velocityX = float(int(random() % 4000) - 2000);
+                body.velocityY = float(int(random() % 4000) - 2000);
+            } else if (kind == 1) {
+                body.isDynamic = true;
+                body.velocityX = float(int(random() % 200) - 100);
+                body.velocityY = float(int(random() % 200) - 100);
+            }
+            Entity entity = registry->CreateEntity();
+            entity.AddComponent<TransformComponent>(glm::vec2(body.x, body.y), glm::vec2(1.0, 1.0), 0.0);
+            entity.AddComponent<BoxColliderComponent>(glm::vec2(0), body.width, body.height);
+            if (body.isDynamic) {
+                entity.AddComponent<RigidBodyComponent>(glm::vec2(body.velocityX, body.velocityY), body.isFastMover);
+            }
+            bodies.emplace_back(entity, body);
+        }
+        registry->Update();
+
+        auto eventBus = std::make_unique<EventBus>();
+        ContactRecorder recorder;
+        eventBus->ListenToEvent<CollisionBeginEvent>(&recorder, &ContactRecorder::OnCollisionBegin);
+        registry->GetSystem<CollisionSystem>().Update(registry, eventBus, deltaTime);
+
+        for (size_t i = 0; i < bodies.size(); i++) {
+            for (size_t j = i + 1; j < bodies.size(); j++) {
+                const Body& a = bodies[i].second;
+                const Body& b = bodies[j].second;
+                // Static colliders never collide with each other
+                if (!a.isDynamic && !b.isDynamic) {
+                    continue;
+                }
+                const std::pair<int, int> pair(bodies[i].first.GetId(), bodies[j].first.GetId());
+                const bool isFound = recorder.begins.count(pair) != 0;
+                // Only fast movers are swept, slow ones are checked where they are
+                const bool isSampled = a.isFastMover || b.isFastMover ? OverlapDuring(a, b, deltaTime, 4000) : OverlapAt(a, b, 0.0);
+                if (isSampled) {
+                    numSampledContacts++;
+                    numMissing += !isFound;
+                } else if (isFound && !OverlapDuring(a, b, deltaTime, 400000)) {
+                    numFalse++;
+                }
+            }
+        }
+    }
+    printf("200 random scenes: %d sampled contacts, %d missing, %d false\n", numSampledContacts, numMissing, numFalse);
+    if (numMissing != 0 || numFalse != 0) {
+        printf("FAILED: the swept contacts differ from the sampled ones\n");
+        hasFailed = true;
+    }
+
+    if (hasFailed) {
+        return 1;
+    }
+    printf("ContinuousCollisionTest: passed\n");
+    return 0;
+}